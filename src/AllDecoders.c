@@ -0,0 +1,113 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file AllDecoders.c
+ * @ingroup interruptHandlers
+ * @ingroup enginePositionRPMDecoders
+ *
+ * @brief Every decoder in one image, chosen at boot from the decoder settings
+ *
+ * The Makefile builds each decoder a second time with its ISRs and init
+ * routine renamed after its file, so that Simple.c provides SimplePrimaryRPMISR,
+ * SimpleSecondaryRPMISR and SimpleDecoderInitPreliminary and so on, then links
+ * all of them in with this file. When linking this image the primary and
+ * secondary RPM vectors are pointed at the two jump slots below, and the init
+ * routine here fills each slot with a jump to the chosen decoder's ISR before
+ * interrupts are enabled. An edge costs one extended jump more than it does in
+ * a single decoder image, with no compare or lookup of any kind.
+ *
+ * To add a decoder here, add it to SINGLEDECODERS in the Makefile, give it a
+ * type in decoderInterface.h and a case below.
+ *
+ * @author Fred Cooke
+ */
+
+
+#include "inc/FreeMS2.h"
+#include "inc/interrupts.h"
+#include "inc/decoderInterface.h"
+
+
+#define JUMP_EXTENDED 0x06	/* JMP opr16a, followed by the address high byte first */
+
+
+/* The RPM vectors point at these, see the Makefile, so they must stay in unpaged RAM */
+unsigned char primaryRPMJumpSlot[3];
+unsigned char secondaryRPMJumpSlot[3];
+
+
+/* The renamed entry points of each decoder, see the Makefile */
+#define DECODER_ENTRY_POINTS(name)								\
+	void name##PrimaryRPMISR(void) INT TEXT1;					\
+	void name##SecondaryRPMISR(void) INT TEXT1;					\
+	void name##DecoderInitPreliminary(void) FPAGE_FE;
+
+DECODER_ENTRY_POINTS(Simple)
+DECODER_ENTRY_POINTS(NipponDenso)
+DECODER_ENTRY_POINTS(MissingTeeth)
+DECODER_ENTRY_POINTS(MiataNB)
+
+
+/* Point a jump slot at an ISR */
+#define FILL_JUMP_SLOT(slot, ISR)								\
+	(slot)[0] = JUMP_EXTENDED;									\
+	(slot)[1] = (unsigned short)(ISR) >> 8;					\
+	(slot)[2] = (unsigned short)(ISR) & 0xFF;
+
+/* Point both jump slots at a decoder and let it set itself up */
+#define SELECT_DECODER(name)									\
+	FILL_JUMP_SLOT(primaryRPMJumpSlot, name##PrimaryRPMISR);	\
+	FILL_JUMP_SLOT(secondaryRPMJumpSlot, name##SecondaryRPMISR);	\
+	name##DecoderInitPreliminary();
+
+
+/** Decoder init
+ *
+ * Called from init() with interrupts still disabled, so the slots can't be
+ * used half written. An unknown type has already been counted as a config
+ * error, the inputs are sent to the unimplemented ISR so that it shows up in
+ * the counters rather than running the wrong decoder.
+ */
+void decoderInitPreliminary(){
+	switch(fixedConfigs1.decoderSettings.decoderType){
+		case DECODER_SIMPLE:
+			SELECT_DECODER(Simple)
+			break;
+		case DECODER_NIPPON_DENSO:
+			SELECT_DECODER(NipponDenso)
+			break;
+		case DECODER_MISSING_TEETH:
+			SELECT_DECODER(MissingTeeth)
+			break;
+		case DECODER_MIATA_NB:
+			SELECT_DECODER(MiataNB)
+			break;
+		default:
+			FILL_JUMP_SLOT(primaryRPMJumpSlot, UISR);
+			FILL_JUMP_SLOT(secondaryRPMJumpSlot, UISR);
+			break;
+	}
+}
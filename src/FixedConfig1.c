@@ -65,8 +65,11 @@ const volatile fixedConfig1 fixedConfigs1 FIXEDCONF1 = {
 		6,                    	/* coils */
 		6,                    	/* combustionEventsPerEngineCycle */
 		2,                    	/* revolutionsPerEngineCycle */
-		24,                   	/* primaryTeeth */
-		0                    	/* missingTeeth */
+		36,                   	/* primaryTeeth */
+		1,                    	/* missingTeeth */
+		1,                    	/* gapCount */
+		{35, 0, 0, 0},        	/* gapPositions */
+		1                    	/* camTeeth */
 		},
 
 		{
@@ -79,7 +82,28 @@ const volatile fixedConfig1 fixedConfigs1 FIXEDCONF1 = {
 		tachoTotalFactor4at50	/* tachoTotalFactor */
 		},
 
-		0x07F0,                 	/* coreSettingsA */
+		{
+		1,                   	/* RPMAveragingTeeth */
+		64,                  	/* noiseWindowFraction */
+		4,                   	/* stallTimeoutTeeth */
+		0xFF,                	/* camSyncTooth */
+		DECODER_MISSING_TEETH,	/* decoderType */
+		0                    	/* gapRatioTolerance */
+		},
+
+		{
+		{0, 6000, 12000, 18000, 24000, 30000},	/* injectionAngles */
+		230,                 	/* maximumInjectorDuty */
+		0,                   	/* overDutySplits */
+		{0, 6000, 12000, 18000, 24000, 30000, 0, 0, 0, 0, 0, 0},	/* ignitionAngles */
+		800,                 	/* multiSparkRPM */
+		1250,                	/* multiSparkGap */
+		3,                   	/* multiSparks */
+		14000,               	/* revLimitRPM */
+		8                    	/* revLimitCut */
+		},
+
+		0x17F0,                 	/* coreSettingsA */
 
 		{"Place your personal notes about whatever you like in here! Don't hesitate to tell us a story about something interesting. Do keep in mind though that when you upload your settings file to the forum this message WILL be visible to all and sundry, so don't be putting too many personal details, bank account numbers, passwords, PIN numbers, license plates, national insurance numbers, IRD numbers, social security numbers, phone numbers, email addresses, love stories and other private information in this field. In fact it is probably best if you keep the information stored here purely related to the vehicle that this system is installed on and relevant to the state of tune and configuration of settings. Lastly, please remember that this field WILL be shrinking in length from it's currently large size to something more reasonable in future. I would like to attempt to keep it at least thirty two characters long though, so writing that much is a non issue, but more won't be possible later!!"}
 };
@@ -30,26 +30,80 @@
  *
  * @brief Miata from 9x to 0x
  *
- * @note Pseudo code that does not compile with zero warnings and errors MUST be commented out.
+ * The crank has two teeth seventy degrees apart every half turn, so the tooth
+ * periods alternate short and long and the crank alone only gives the position
+ * to within half a turn. The cam has one tooth in the first quarter of the
+ * cycle, two in the second, none in the third and one in the fourth, each in
+ * the long period after a crank tooth. Counting cam edges between crank teeth
+ * gives the rest.
+ *
+ * Crank teeth are numbered from zero in cycle order, so the short period always
+ * ends on an odd tooth. Position is declared by whichever signature completes
+ * first while cranking. Two cam edges between crank teeth are unique on their
+ * own. One cam edge is one of two, and the crank says which, as the tooth
+ * after the first quarter single ends a long period and the tooth after the
+ * fourth quarter single ends a short one. Once synced every period has to be
+ * the right length for its tooth and every gap has to hold the right number of
+ * cam edges, or sync is dropped and counted against the input that disagreed.
  *
- * @todo TODO This file contains SFA but Abe Mara is going to fill it up with
- * @todo TODO wonderful goodness very soon ;-)
+ * @note Pseudo code that does not compile with zero warnings and errors MUST be commented out.
  *
  * @author Who Ever
  */
 
 
+#define DECODER_IMPLEMENTATION_C
 #include "inc/FreeMS2.h"
 #include "inc/interrupts.h"
 #include "inc/decoderInterface.h"
+#include "inc/outputScheduler.h"
+
+
+#define NB_CRANK_TEETH 8					/* Two per half turn */
+#define NB_PAIR_ANGLE (70 * ANGLE_FACTOR)	/* From the first tooth of a pair to the second */
+#define NB_AFTER_DOUBLE_TOOTH 4				/* The crank tooth after the two cam edges */
+#define NB_AFTER_FIRST_SINGLE_TOOTH 2		/* The crank tooth after the first quarter single, ends a long period */
+#define NB_AFTER_LAST_SINGLE_TOOTH 7		/* The crank tooth after the fourth quarter single, ends a short period */
+
+/* How many cam edges follow each crank tooth before the next one */
+static const unsigned char camEdgesAfterTooth[NB_CRANK_TEETH] = {0, 1, 0, 2, 0, 0, 1, 0};
+
+/* Shared by both inputs */
+static unsigned char camEdgesThisGap;		/* Cam edges since the last crank tooth */
+
+
+/** Decoder init
+ *
+ * Each crank tooth is a wheel event over the full cycle. Periods alternate so
+ * the last two are published together, which is always half a turn.
+ */
+void decoderInitPreliminary(){
+	numberOfWheelEvents = NB_CRANK_TEETH;
+	wheelEventCycleAngle = ENGINE_CYCLE_ANGLE;
+	unsigned char tooth;
+	for(tooth = 0;tooth < NB_CRANK_TEETH;tooth++){
+		wheelEventAngles[tooth] = ((tooth >> 1) * (ENGINE_CYCLE_ANGLE / 4)) + ((tooth & 1) * NB_PAIR_ANGLE);
+	}
+	toothPeriodAngle = ENGINE_CYCLE_ANGLE / 4;
+	outputCycleAngle = wheelEventCycleAngle;
+
+	RPMDividend = (ticksPerCycleAtOneRPMx2 / 4) * fixedConfigs1.decoderSettings.RPMAveragingTeeth;
+}
 
 
 /** Primary RPM ISR
  *
- * @todo TODO Docs here!
+ * Only the configured edge is used. The cam edges counted since the last tooth
+ * and whether this period is shorter than the last either find the position or
+ * check it, see the top of the file.
  */
 void PrimaryRPMISR(void)
 {
+	static LongTime lastTimeStamp = { 0 };
+	static unsigned long lastToothPeriod = 0;
+	static unsigned char teethSeen = 0;		/* Counts to three, one for a time stamp, two for a period, three to compare periods */
+	static unsigned char currentTooth = 0;
+
 	/* Clear the interrupt flag for this input compare channel */
 	TFLG = 0x01;
 
@@ -62,8 +116,6 @@ void PrimaryRPMISR(void)
 	/* Calculate the latency in ticks */
 	ISRLatencyVars.primaryInputLatency = codeStartTimeStamp - edgeTimeStamp;
 
-	// TODO discard narrow ones! test for tooth width and tooth period
-
 	/* Set up edges as per config */
 	unsigned char risingEdge;
 	if(fixedConfigs1.coreSettingsA & PRIMARY_POLARITY){
@@ -72,20 +124,81 @@ void PrimaryRPMISR(void)
 		risingEdge = !(PTITCurrentState & 0x01);
 	}
 
-	if(risingEdge){
-		// increment crank pulses TODO this needs to be wrapped in tooth period and width checking
-		primaryPulsesPerSecondaryPulse++;
+	LongTime timeStamp;
 
-		LongTime timeStamp;
+	EXTEND_TIME_STAMP(timeStamp, edgeTimeStamp);
+	REJECT_PRIMARY_NOISE(risingEdge, timeStamp.timeLong, lastTimeStamp.timeLong, PTITCurrentState);
+	FEED_STALL_WATCHDOG();
+	LOG_TRIGGER_EDGE(timeStamp.timeLong, TRIGGER_LOG_PRIMARY, PTITCurrentState);
+
+	if(risingEdge){
+		/* Nothing from before the engine last stopped can be believed */
+		if(!(coreStatusA & PRIMARY_SYNC) && (teethBeforeSync == 0)){
+			teethSeen = 0;
+		}
+		if(teethSeen < 3){
+			teethSeen++;
+		}
 
-		/* Install the low word */
-		timeStamp.timeShorts[1] = edgeTimeStamp;
-		/* Find out what our timer value means and put it in the high word */
-		if(TFLGOF && !(edgeTimeStamp & 0x8000)){ /* see 10.3.5 paragraph 4 of 68hc11 ref manual for details */
-			timeStamp.timeShorts[0] = timerExtensionClock + 1;
+		/* How many ticks between teeth? Unsigned subtraction takes care of wrap around */
+		unsigned long thisPeriod = timeStamp.timeLong - lastTimeStamp.timeLong;
+		lastTimeStamp.timeLong = timeStamp.timeLong;
+		unsigned char endedShort = (thisPeriod < lastToothPeriod);
+
+		/* The gap that just ended follows the last tooth */
+		unsigned char camEdges = camEdgesThisGap;
+		camEdgesThisGap = 0;
+
+		if(coreStatusA & PRIMARY_SYNC){
+			unsigned char lastTooth = currentTooth;
+			currentTooth++;
+			if(currentTooth == NB_CRANK_TEETH){
+				currentTooth = 0;
+			}
+			if(camEdges != camEdgesAfterTooth[lastTooth]){
+				coreStatusA &= CLEAR_PRIMARY_SYNC;
+				Counters.camSyncLosses++;
+			}else if((teethSeen == 3) && (endedShort != (currentTooth & 1))){
+				coreStatusA &= CLEAR_PRIMARY_SYNC;
+				Counters.crankSyncLosses++;
+			}
 		}else{
-			timeStamp.timeShorts[0] = timerExtensionClock;
+			COUNT_TOOTH_BEFORE_SYNC();
+			if(teethSeen < 2){
+				/* Cam edges before the first tooth can't be placed */
+			}else if(camEdges == 2){
+				/* The cam alone, the crank checks it from the next period on */
+				currentTooth = NB_AFTER_DOUBLE_TOOTH;
+				coreStatusA |= PRIMARY_SYNC;
+			}else if((camEdges == 1) && (teethSeen == 3)){
+				/* The crank says which single it was */
+				if(endedShort){
+					currentTooth = NB_AFTER_LAST_SINGLE_TOOTH;
+				}else{
+					currentTooth = NB_AFTER_FIRST_SINGLE_TOOTH;
+				}
+				coreStatusA |= PRIMARY_SYNC;
+			}
+			if(coreStatusA & PRIMARY_SYNC){
+				RECORD_FIRST_SYNC(currentTooth);
+			}
+		}
+
+		/* A short and a long period always make half a turn, publish them together */
+		if(teethSeen == 3){
+			unsigned long halfTurnPeriod = thisPeriod + lastToothPeriod;
+			PUBLISH_TOOTH_PERIOD(halfTurnPeriod);
 		}
+		lastToothPeriod = thisPeriod;
+
+		currentWheelEvent = currentTooth;
+		wheelEventTimeStamp = timeStamp.timeLong;
+
+		if(coreStatusA & PRIMARY_SYNC){
+			/* Arm whatever the main loop compiled for this tooth */
+			scheduleOutputEvents(currentWheelEvent, timeStamp.timeLong);
+		}
+
 		RuntimeVars.primaryInputLeadingRuntime = TCNT - codeStartTimeStamp;
 	}else{
 		RuntimeVars.primaryInputTrailingRuntime = TCNT - codeStartTimeStamp;
@@ -97,16 +210,17 @@ void PrimaryRPMISR(void)
 
 /** Secondary RPM ISR
  *
- * @todo TODO Docs here!
+ * Only the configured edge is used. Its phase is captured for the main loop
+ * and it is counted for the next crank tooth to place.
  */
 void SecondaryRPMISR(void)
 {
 	/* Clear the interrupt flag for this input compare channel */
-	TFLG = 0x02;
+	TFLG = 0x20;
 
 	/* Save all relevant available data here */
 	unsigned short codeStartTimeStamp = TCNT;		/* Save the current timer count */
-	unsigned short edgeTimeStamp = TC1;				/* Save the timestamp */
+	unsigned short edgeTimeStamp = TC5;				/* Save the timestamp */
 	unsigned char PTITCurrentState = PTIT;			/* Save the values on port T regardless of the state of DDRT */
 //	unsigned short PORTS_BACurrentState = PORTS_BA;	/* Save ignition output state */
 
@@ -118,23 +232,19 @@ void SecondaryRPMISR(void)
 	/* Set up edges as per config */
 	unsigned char risingEdge;
 	if(fixedConfigs1.coreSettingsA & SECONDARY_POLARITY){
-		risingEdge = PTITCurrentState & 0x02;
+		risingEdge = PTITCurrentState & 0x20;
 	}else{
-		risingEdge = !(PTITCurrentState & 0x02);
+		risingEdge = !(PTITCurrentState & 0x20);
 	}
 
-	if(risingEdge){
-		LongTime timeStamp;
+	LongTime timeStamp;
 
-		/* Install the low word */
-		timeStamp.timeShorts[1] = edgeTimeStamp;
-		/* Find out what our timer value means and put it in the high word */
-		if(TFLGOF && !(edgeTimeStamp & 0x8000)){ /* see 10.3.5 paragraph 4 of 68hc11 ref manual for details */
-			timeStamp.timeShorts[0] = timerExtensionClock + 1;
-		}else{
-			timeStamp.timeShorts[0] = timerExtensionClock;
-		}
+	EXTEND_TIME_STAMP(timeStamp, edgeTimeStamp);
+	LOG_TRIGGER_EDGE(timeStamp.timeLong, TRIGGER_LOG_SECONDARY, PTITCurrentState);
 
+	if(risingEdge){
+		CAPTURE_CAM_EDGE(timeStamp.timeLong);
+		camEdgesThisGap++;
 		RuntimeVars.secondaryInputLeadingRuntime = TCNT - codeStartTimeStamp;
 	}else{
 		RuntimeVars.secondaryInputTrailingRuntime = TCNT - codeStartTimeStamp;
@@ -27,7 +27,42 @@
  * @ingroup interruptHandlers
  * @ingroup enginePositionRPMDecoders
  *
- * @brief Missing teeth, mostly 36-1 and 60-2
+ * @brief Table driven missing teeth, 36-1, 60-2, 36-2-2-2 and friends
+ *
+ * Any crank wheel made of evenly spaced teeth with one or more groups of teeth
+ * removed is handled here. The shape of the wheel comes from the engine
+ * settings in the first fixed config block, namely primary teeth, missing
+ * teeth, gap count and gap positions. At boot decoderInitPreliminary() turns
+ * that description into a few small tables so that the primary ISR only ever
+ * indexes and compares, with no modulo and no per wheel special cases.
+ *
+ * Teeth are numbered from zero starting with the first tooth after the first
+ * gap and counting only those teeth that are physically present.
+ *
+ * With a gap ratio tolerance configured the decoder also learns the ratio of
+ * each tooth period to the one before it, seeded from the wheel shape and
+ * nudged one step per revolution toward what is seen while synced. A gap must
+ * then match its own learned ratio within the tolerance, a normal tooth only
+ * fails if it is both longer than its own learned ratio allows and as long as
+ * a learned gap, and a gap is only believed without sync when it is nearly as
+ * long as the learned gaps. Cranking stutter and slightly damaged teeth that
+ * would fool the fixed one and a half times test on a 60-2 wheel don't.
+ *
+ * With a cam sync tooth configured the cam edge also declares the position,
+ * as the configured tooth, if it arrives before the crank has found a gap but
+ * after two crank teeth, so that the next tooth has a period to be checked by.
+ * The next gap then has to be where the cam said it would be, and from then on
+ * every cam edge has to follow the configured tooth, or sync is dropped and
+ * counted as a cam sync loss. On a 60-2 wheel this can save most of a turn of
+ * cranking. Choose a tooth with the cam edge well clear of the crank edges on
+ * either side of it over the whole range of any variable cam timing. Only one
+ * cam tooth is allowed, initConfiguration() refuses more.
+ *
+ * On a four stroke the cam edge also says which turn of the crank this is, the
+ * one it arrives in being the first. With one turn per cycle there is no turn
+ * to tell, so the cam edge only has to be on its tooth. Outputs then repeat over the full cycle,
+ * the teeth of the second turn being numbered on from those of the first, and
+ * nothing is scheduled until the cam has said so, even with a gap found.
  *
  * @note Pseudo code that does not compile with zero warnings and errors MUST be commented out.
  *
@@ -35,22 +70,134 @@
  */
 
 
+#define DECODER_IMPLEMENTATION_C
 #include "inc/FreeMS2.h"
 #include "inc/interrupts.h"
 #include "inc/decoderInterface.h"
+#include "inc/outputScheduler.h"
+
+
+/* Wheel tables, built once at boot from the engine settings */
+static unsigned char presentTeeth;									/* How many teeth physically exist on the wheel */
+static unsigned char gapPrecedesTooth[MAXIMUM_PRIMARY_TEETH];		/* Non zero where the period ending at a tooth spans a gap */
+static unsigned char teethAfterGap[MAXIMUM_WHEEL_GAPS];				/* How many teeth there are between each gap and the next */
+static unsigned char toothAfterFollowingGap[MAXIMUM_WHEEL_GAPS];	/* Number of the first tooth after the gap that follows each gap */
+
+/* Learned ratio mode, ratios are in 64ths so one byte per tooth covers up to four times */
+#define LEARNED_RATIO_ONE 64
+#define LEARNED_RATIO_MAX 255
+static unsigned char learnedRatios[MAXIMUM_PRIMARY_TEETH];			/* Period ending at each tooth over the period before it */
+static unsigned char gapRatioThreshold;								/* Shortest ratio that is believed to be a gap without sync */
+
+/* Shared by both inputs so that whichever of them finds the position first can declare it */
+static unsigned char currentTooth;									/* Number of the last tooth seen, only meaningful with sync */
+static unsigned char syncedByCam;									/* Sync came from the cam and no gap has confirmed it yet */
+
+
+/** Build the wheel tables
+ *
+ * Walk the configured gaps in order and number the teeth between them. The
+ * configuration has already been range checked in initConfiguration() so the
+ * tables can not be overrun here.
+ *
+ * @author Fred Cooke
+ */
+void decoderInitPreliminary(){
+	unsigned char gapCount = fixedConfigs1.engineSettings.gapCount;
+	unsigned char firstToothAfterGap[MAXIMUM_WHEEL_GAPS];
+	unsigned char gap;
+
+	/* Crank only, so every present tooth is a wheel event and they repeat each revolution of the wheel */
+	wheelEventCycleAngle = ENGINE_CYCLE_ANGLE / fixedConfigs1.engineSettings.revolutionsPerEngineCycle;
+
+	presentTeeth = 0;
+	for(gap = 0;gap < gapCount;gap++){
+		unsigned char nextGap = gap + 1;
+		unsigned short endOfTeeth;
+		if(nextGap == gapCount){
+			nextGap = 0;
+			endOfTeeth = fixedConfigs1.engineSettings.primaryTeeth + fixedConfigs1.engineSettings.gapPositions[0];
+		}else{
+			endOfTeeth = fixedConfigs1.engineSettings.gapPositions[nextGap];
+		}
+
+		firstToothAfterGap[gap] = presentTeeth;
+		teethAfterGap[gap] = endOfTeeth - (fixedConfigs1.engineSettings.gapPositions[gap] + fixedConfigs1.engineSettings.missingTeeth);
+
+		/* Slots are counted from the first tooth after the first gap */
+		unsigned short slot = (fixedConfigs1.engineSettings.gapPositions[gap] + fixedConfigs1.engineSettings.missingTeeth) - (fixedConfigs1.engineSettings.gapPositions[0] + fixedConfigs1.engineSettings.missingTeeth);
+
+		unsigned char tooth;
+		for(tooth = 0;tooth < teethAfterGap[gap];tooth++){
+			gapPrecedesTooth[presentTeeth] = (tooth == 0);
+			wheelEventAngles[presentTeeth] = ((unsigned long)(slot + tooth) * wheelEventCycleAngle) / fixedConfigs1.engineSettings.primaryTeeth;
+			presentTeeth++;
+		}
+	}
+	numberOfWheelEvents = presentTeeth;
+	toothPeriodAngle = wheelEventCycleAngle / fixedConfigs1.engineSettings.primaryTeeth;
+
+	/* With cam phase the outputs can be sequential over both turns */
+	outputCycleAngle = wheelEventCycleAngle;
+	if((fixedConfigs1.decoderSettings.camSyncTooth < presentTeeth) && (wheelEventCycleAngle < ENGINE_CYCLE_ANGLE)){
+		outputCycleAngle = ENGINE_CYCLE_ANGLE;
+	}
+
+	/* Only normal teeth are published, each of which is one slot of the wheel */
+	RPMDividend = (ticksPerCycleAtOneRPMx2 / ((unsigned short)fixedConfigs1.engineSettings.primaryTeeth * fixedConfigs1.engineSettings.revolutionsPerEngineCycle)) * fixedConfigs1.decoderSettings.RPMAveragingTeeth;
+
+	for(gap = 0;gap < gapCount;gap++){
+		if((gap + 1) == gapCount){
+			toothAfterFollowingGap[gap] = firstToothAfterGap[0];
+		}else{
+			toothAfterFollowingGap[gap] = firstToothAfterGap[gap + 1];
+		}
+	}
+
+	/* Seed the learned ratios from the slots each period spans, then it is up to the engine */
+	unsigned char gapSlots = fixedConfigs1.engineSettings.missingTeeth + 1;
+	unsigned char previousTooth = presentTeeth - 1;
+	unsigned char tooth;
+	for(tooth = 0;tooth < presentTeeth;tooth++){
+		unsigned short ratio = LEARNED_RATIO_ONE;
+		if(gapPrecedesTooth[tooth]){
+			ratio *= gapSlots;
+		}
+		if(gapPrecedesTooth[previousTooth]){
+			ratio /= gapSlots;
+		}
+		if(ratio > LEARNED_RATIO_MAX){
+			ratio = LEARNED_RATIO_MAX;
+		}
+		learnedRatios[tooth] = ratio;
+		previousTooth = tooth;
+	}
+	unsigned short gapRatio = LEARNED_RATIO_ONE * gapSlots;
+	if(gapRatio > LEARNED_RATIO_MAX){
+		gapRatio = LEARNED_RATIO_MAX;
+	}
+	gapRatioThreshold = gapRatio - ((gapRatio * fixedConfigs1.decoderSettings.gapRatioTolerance) >> 8);
+}
 
 
 /** Primary RPM ISR
  *
- * @todo TODO Docs here!
+ * Only the configured edge is used. Each period is compared with one and a
+ * half times the period before it, or the learned gap ratio less the tolerance
+ * in learned mode, to decide whether it spans a gap.
+ * Without sync the teeth seen between gaps identify which gap just passed, with
+ * sync the gap table says whether a gap was expected before this tooth and any
+ * disagreement drops sync. In learned mode with sync the learned ratio for
+ * this tooth decides instead, see the top of the file. A tooth with no period
+ * before it to compare with is neither checked nor learned from.
+ *
+ * @author Philip Johnson
  */
 void PrimaryRPMISR(void) {
-	static LongTime thisHighLowTime = { 0 };
-	static LongTime lastHighLowTime = { 0 };
-	static LongTime lowTime = { 0 };
-	static LongTime lastPeriod = { 0 };
 	static LongTime lastTimeStamp = { 0 };
-	static unsigned int count = 0;
+	static unsigned long lastToothPeriod = 0;	/* Period of the last tooth, gap or not */
+	static unsigned long gapThreshold = 0;		/* One and a half times the above, or the learned gap ratio of it */
+	static unsigned char teethSinceGap = 0;
 
 	/* Clear the interrupt flag for this input compare channel */
 	TFLG = 0x01;
@@ -64,82 +211,178 @@ void PrimaryRPMISR(void) {
 	/* Calculate the latency in ticks */
 	ISRLatencyVars.primaryInputLatency = codeStartTimeStamp - edgeTimeStamp;
 
-	LongTime thisTimeStamp;
-	/* Install the low word */
-	thisTimeStamp.timeShorts[1] = edgeTimeStamp;
-	/* Find out what our timer value means and put it in the high word */
-	if (TFLGOF && !(edgeTimeStamp & 0x8000)) { /* see 10.3.5 paragraph 4 of 68hc11 ref manual for details */
-		thisTimeStamp.timeShorts[0] = timerExtensionClock + 1;
+	/* Set up edges as per config */
+	unsigned char risingEdge;
+	if (fixedConfigs1.coreSettingsA & PRIMARY_POLARITY) {
+		risingEdge = PTITCurrentState & 0x01;
 	} else {
-		thisTimeStamp.timeShorts[0] = timerExtensionClock;
+		risingEdge = !(PTITCurrentState & 0x01);
 	}
 
-	/* How many ticks between transitions? */
-	LongTime thisPeriod;
-	if (thisTimeStamp.timeLong > lastTimeStamp.timeLong) {
-		thisPeriod.timeLong = thisTimeStamp.timeLong - lastTimeStamp.timeLong;
-	} else {
-		thisPeriod.timeLong = thisTimeStamp.timeLong + (0xFFFFFFFF
-				- lastTimeStamp.timeLong);
-	}
-	lastTimeStamp.timeLong = thisTimeStamp.timeLong;
+	LongTime thisTimeStamp;
+	EXTEND_TIME_STAMP(thisTimeStamp, edgeTimeStamp);
+	REJECT_PRIMARY_NOISE(risingEdge, thisTimeStamp.timeLong, lastTimeStamp.timeLong, PTITCurrentState);
+	FEED_STALL_WATCHDOG();
+	LOG_TRIGGER_EDGE(thisTimeStamp.timeLong, TRIGGER_LOG_PRIMARY, PTITCurrentState);
 
-	/* Set up edges as per config */
-	unsigned char risingEdge = PTITCurrentState & 0x01;
-
-	if (lastPeriod.timeLong != 0) {
-		if (risingEdge) {
-			thisHighLowTime.timeLong = thisPeriod.timeLong + lowTime.timeLong;
-			//Find the missing tooth
-			if (count == 0 || count == 70) {
-				if (thisHighLowTime.timeLong > (lastHighLowTime.timeLong + (lastHighLowTime.timeLong>>1)) &&
-						thisHighLowTime.timeLong < ((lastHighLowTime.timeLong<<1) + (lastHighLowTime.timeLong>>1))) {
-					// We have sync
-					count = 1;
+	if (risingEdge) {
+		/* How many ticks between teeth? Unsigned subtraction takes care of wrap around */
+		unsigned long thisPeriod = thisTimeStamp.timeLong - lastTimeStamp.timeLong;
+		lastTimeStamp.timeLong = thisTimeStamp.timeLong;
+
+		/* The first tooth since the engine stopped only starts a period, and the one before the stop is meaningless */
+		unsigned char firstTooth = !(coreStatusA & PRIMARY_SYNC) && (teethBeforeSync == 0);
+		if (firstTooth) {
+			lastToothPeriod = 0;
+		}
+
+		unsigned char gapSeen = (thisPeriod > gapThreshold);
+		if (lastToothPeriod == 0) {
+			/* Nothing to compare against yet, treat the first period as a normal tooth */
+			gapSeen = 0;
+		}
+
+		if (coreStatusA & PRIMARY_SYNC) {
+			currentTooth++;
+			if (currentTooth == presentTeeth) {
+				currentTooth = 0;
+				coreStatusA ^= ENGINE_PHASE;
+			}
+			unsigned char toothValid;
+			unsigned char tolerance = fixedConfigs1.decoderSettings.gapRatioTolerance;
+			if (lastToothPeriod == 0) {
+				/* Nothing to check this tooth against or learn from, so take the table's word for it */
+				toothValid = 1;
+				gapSeen = gapPrecedesTooth[currentTooth];
+			} else if (tolerance) {
+				/* Multiplies only, the learned ratio of this tooth gives the expected period and the tolerance a margin around it */
+				unsigned char ratio = learnedRatios[currentTooth];
+				unsigned long expectedPeriod = (lastToothPeriod * ratio) >> 6;
+				unsigned long margin = (expectedPeriod >> 8) * tolerance;
+				if (gapPrecedesTooth[currentTooth]) {
+					/* A gap must be the gap we learned */
+					toothValid = !((thisPeriod + margin < expectedPeriod) || (thisPeriod > expectedPeriod + margin));
 				} else {
-					//We have lost sync
-					count = 0;
+					/* A normal tooth only fails if it is too long for itself and also long enough to be a gap */
+					toothValid = !((thisPeriod > expectedPeriod + margin) && gapSeen);
+				}
+
+				if (toothValid) {
+					/* The table knows better than the threshold which periods are gaps */
+					gapSeen = gapPrecedesTooth[currentTooth];
+
+					/* Step the learned ratio toward this one, one 64th per revolution averages out the odd bad tooth */
+					if (((thisPeriod << 6) > (lastToothPeriod * ratio)) && (ratio < LEARNED_RATIO_MAX)) {
+						ratio++;
+					} else if (((thisPeriod << 6) < (lastToothPeriod * ratio)) && (ratio > 1)) {
+						ratio--;
+					}
+					learnedRatios[currentTooth] = ratio;
+
+					/* Only gaps after a normal tooth say how long a gap looks from a standing start */
+					if (gapSeen && (ratio > (LEARNED_RATIO_ONE + (LEARNED_RATIO_ONE >> 1)))) {
+						gapRatioThreshold = ratio - ((ratio * tolerance) >> 8);
+					}
 				}
-			}else if (count == 2 || (count%2 == 0 &&
-					thisHighLowTime.timeLong > (lastHighLowTime.timeLong>>1) &&
-					thisHighLowTime.timeLong < (lastHighLowTime.timeLong<<1) )) {
-				count++;
 			} else {
-				//We have lost sync
-				count = 0;
+				toothValid = (gapSeen == gapPrecedesTooth[currentTooth]);
+			}
+			if (!toothValid) {
+				coreStatusA &= (CLEAR_PRIMARY_SYNC & CLEAR_SECONDARY_SYNC);
+				if (syncedByCam) {
+					/* The crank disagrees with where the cam said we were */
+					Counters.camSyncLosses++;
+				} else {
+					Counters.crankSyncLosses++;
+				}
+			} else if (gapPrecedesTooth[currentTooth]) {
+				syncedByCam = 0;
+			}
+		} else {
+			COUNT_TOOTH_BEFORE_SYNC();
+			if (gapSeen) {
+				unsigned char gapCount = fixedConfigs1.engineSettings.gapCount;
+				if (gapCount == 1) {
+					/* Only one gap, so this must be it */
+					currentTooth = 0;
+					coreStatusA |= PRIMARY_SYNC;
+				} else {
+					/* The teeth between the last two gaps tell us which gap we are at */
+					unsigned char gap;
+					for (gap = 0; gap < gapCount; gap++) {
+						if (teethSinceGap == teethAfterGap[gap]) {
+							currentTooth = toothAfterFollowingGap[gap];
+							coreStatusA |= PRIMARY_SYNC;
+							break;
+						}
+					}
+				}
+				if (coreStatusA & PRIMARY_SYNC) {
+					syncedByCam = 0;
+					RECORD_FIRST_SYNC(currentTooth);
+				}
 			}
+		}
 
-			// increment crank pulses TODO this needs to be wrapped in tooth period and width checking
-			lastHighLowTime.timeLong = thisHighLowTime.timeLong;
-			primaryPulsesPerSecondaryPulse++;
-			RuntimeVars.primaryInputLeadingRuntime = TCNT - codeStartTimeStamp;
+		/* Every period is the reference for the next, so one bogus short period can't make every tooth after it look like a gap */
+		lastToothPeriod = firstTooth ? 0 : thisPeriod;
+		if (fixedConfigs1.decoderSettings.gapRatioTolerance) {
+			gapThreshold = (thisPeriod * gapRatioThreshold) >> 6;
 		} else {
-			if (count%2 == 1) {
-				count++;
-			} else {
-				//We have lost sync
-				count = 0;
+			gapThreshold = thisPeriod + (thisPeriod >> 1);
+		}
+
+		if (gapSeen) {
+			teethSinceGap = 1;
+		} else {
+			/* Only normal teeth are published for RPM */
+			teethSinceGap++;
+			if (!firstTooth) {
+				PUBLISH_TOOTH_PERIOD(thisPeriod);
 			}
-			RuntimeVars.primaryInputTrailingRuntime = TCNT - codeStartTimeStamp;
-			lowTime.timeLong = thisPeriod.timeLong;
 		}
+		currentWheelEvent = currentTooth;
+		wheelEventTimeStamp = thisTimeStamp.timeLong;
+
+		if (coreStatusA & PRIMARY_SYNC) {
+			if (outputCycleAngle == wheelEventCycleAngle) {
+				/* Arm whatever the main loop compiled for this tooth */
+				scheduleOutputEvents(currentWheelEvent, thisTimeStamp.timeLong);
+			} else if (coreStatusA & SECONDARY_SYNC) {
+				/* Or for this tooth in this turn of the crank */
+				unsigned char wheelEvent = currentWheelEvent;
+				if (coreStatusA & ENGINE_PHASE) {
+					wheelEvent += presentTeeth;
+				}
+				scheduleOutputEvents(wheelEvent, thisTimeStamp.timeLong);
+			}
+		}
+
+		primaryPulsesPerSecondaryPulse++;
+		RuntimeVars.primaryInputLeadingRuntime = TCNT - codeStartTimeStamp;
+	} else {
+		RuntimeVars.primaryInputTrailingRuntime = TCNT - codeStartTimeStamp;
 	}
-	lastPeriod.timeLong = thisPeriod.timeLong;
+
 	Counters.primaryTeethSeen++;
 }
 
 
 /** Secondary RPM ISR
  *
- * @todo TODO Docs here!
+ * Only the configured edge is used. Its phase is captured for the main loop
+ * and, with a cam sync tooth configured, it either declares the position or
+ * checks the one that the crank already found, see the top of the file.
+ *
+ * @author Fred Cooke
  */
 void SecondaryRPMISR(void) {
 	/* Clear the interrupt flag for this input compare channel */
-	TFLG = 0x02;
+	TFLG = 0x20;
 
 	/* Save all relevant available data here */
 	unsigned short codeStartTimeStamp = TCNT; /* Save the current timer count */
-	unsigned short edgeTimeStamp = TC1; /* Save the timestamp */
+	unsigned short edgeTimeStamp = TC5; /* Save the timestamp */
 	unsigned char PTITCurrentState = PTIT; /* Save the values on port T regardless of the state of DDRT */
 	//	unsigned short PORTS_BACurrentState = PORTS_BA;	/* Save ignition output state */
 
@@ -151,22 +394,41 @@ void SecondaryRPMISR(void) {
 	/* Set up edges as per config */
 	unsigned char risingEdge;
 	if (fixedConfigs1.coreSettingsA & SECONDARY_POLARITY) {
-		risingEdge = PTITCurrentState & 0x02;
+		risingEdge = PTITCurrentState & 0x20;
 	} else {
-		risingEdge = !(PTITCurrentState & 0x02);
+		risingEdge = !(PTITCurrentState & 0x20);
 	}
 
-	if (risingEdge) {
+	LongTime timeStamp;
 
-		LongTime timeStamp;
+	EXTEND_TIME_STAMP(timeStamp, edgeTimeStamp);
+	LOG_TRIGGER_EDGE(timeStamp.timeLong, TRIGGER_LOG_SECONDARY, PTITCurrentState);
 
-		/* Install the low word */
-		timeStamp.timeShorts[1] = edgeTimeStamp;
-		/* Find out what our timer value means and put it in the high word */
-		if (TFLGOF && !(edgeTimeStamp & 0x8000)) { /* see 10.3.5 paragraph 4 of 68hc11 ref manual for details */
-			timeStamp.timeShorts[0] = timerExtensionClock + 1;
-		} else {
-			timeStamp.timeShorts[0] = timerExtensionClock;
+	if (risingEdge) {
+		CAPTURE_CAM_EDGE(timeStamp.timeLong);
+
+		/* Whichever input finds the position first declares it and the other confirms it */
+		unsigned char camSyncTooth = fixedConfigs1.decoderSettings.camSyncTooth;
+		if (camSyncTooth < presentTeeth) {
+			if (coreStatusA & PRIMARY_SYNC) {
+				unsigned char wrongTurn = (outputCycleAngle != wheelEventCycleAngle) && (coreStatusA & SECONDARY_SYNC) && (coreStatusA & ENGINE_PHASE);
+				if ((currentTooth != camSyncTooth) || wrongTurn) {
+					/* Wrong tooth, or the right one in the wrong turn */
+					coreStatusA &= (CLEAR_PRIMARY_SYNC & CLEAR_SECONDARY_SYNC);
+					Counters.camSyncLosses++;
+				} else {
+					coreStatusA |= SECONDARY_SYNC;
+					coreStatusA &= CLEAR_ENGINE_PHASE;
+				}
+			} else if (teethBeforeSync > 1) {
+				/* A crank period has been seen, so the next tooth can be checked and scheduled from without waiting for a gap */
+				currentTooth = camSyncTooth;
+				currentWheelEvent = currentTooth;
+				syncedByCam = 1;
+				coreStatusA |= (PRIMARY_SYNC | SECONDARY_SYNC);
+				coreStatusA &= CLEAR_ENGINE_PHASE;
+				RECORD_FIRST_SYNC(currentTooth);
+			}
 		}
 
 		RuntimeVars.secondaryInputLeadingRuntime = TCNT - codeStartTimeStamp;
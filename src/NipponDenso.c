@@ -52,12 +52,34 @@
  */
 
 
+#define DECODER_IMPLEMENTATION_C
 #include "inc/FreeMS2.h"
 #include "inc/interrupts.h"
 #include "inc/decoderInterface.h"
+#include "inc/outputScheduler.h"
 #include "inc/utils.h"
 
 
+/** Decoder init
+ *
+ * Twelve primary teeth per secondary pulse and two of those per cycle. The
+ * wheel events are the twelve teeth, thirty degrees apart, repeating each
+ * revolution.
+ */
+void decoderInitPreliminary(){
+	RPMDividend = (ticksPerCycleAtOneRPMx2 / 24) * fixedConfigs1.decoderSettings.RPMAveragingTeeth;
+
+	numberOfWheelEvents = 12;
+	wheelEventCycleAngle = ENGINE_CYCLE_ANGLE / 2;
+	unsigned char wheelEvent;
+	for(wheelEvent = 0;wheelEvent < numberOfWheelEvents;wheelEvent++){
+		wheelEventAngles[wheelEvent] = wheelEvent * (ENGINE_CYCLE_ANGLE / 24);
+	}
+	toothPeriodAngle = ENGINE_CYCLE_ANGLE / 24;
+	outputCycleAngle = wheelEventCycleAngle;
+}
+
+
 /** Primary RPM ISR
  *
  * Summary of intended engine position capture scheme (out of date as at 3/1/09)
@@ -95,12 +117,18 @@ void PrimaryRPMISR(){
 	/* Calculate the latency in ticks */
 	ISRLatencyVars.primaryInputLatency = codeStartTimeStamp - edgeTimeStamp;
 
-	/** @todo TODO discard narrow ones! test for tooth width and tooth period
-	 * the width should be based on how the hardware is setup. IE the LM1815
-	 * is adjusted to have a pulse output of a particular width. This noise
-	 * filter should be matched to that width as should the hardware filter.
+	/** @todo TODO test for tooth width too, the width should be based on how
+	 * the hardware is setup. IE the LM1815 is adjusted to have a pulse output
+	 * of a particular width. Tooth period is checked by the noise window below.
 	 */
 
+	LongTime timeStamp;
+
+	EXTEND_TIME_STAMP(timeStamp, edgeTimeStamp);
+	REJECT_PRIMARY_NOISE(PTITCurrentState & 0x01, timeStamp.timeLong, lastPrimaryPulseTimeStamp, PTITCurrentState);
+	FEED_STALL_WATCHDOG();
+	LOG_TRIGGER_EDGE(timeStamp.timeLong, TRIGGER_LOG_PRIMARY, PTITCurrentState);
+
 	/* The LM1815 variable reluctance sensor amplifier allows the output to be
 	 * pulled high starting at the center of a tooth. So, what we see as the
 	 * start of a tooth is actually the centre of a physical tooth. Because
@@ -111,30 +139,22 @@ void PrimaryRPMISR(){
 		// increment crank pulses TODO this needs to be wrapped in tooth period and width checking
 		primaryPulsesPerSecondaryPulse++;
 
-		// calculate rough rpm (this will be wrong when the var is used correctly)
-		*RPMRecord = ticksPerCycleAtOneRPMx2 / engineCyclePeriod; /* 0.8us ticks, 150mil = 2 x 60 seconds, times rpm scale factor of 2 */
+		// temporary data from inputs
+		primaryLeadingEdgeTimeStamp = timeStamp.timeLong;
+		timeBetweenSuccessivePrimaryPulses = primaryLeadingEdgeTimeStamp - lastPrimaryPulseTimeStamp;
+		lastPrimaryPulseTimeStamp = primaryLeadingEdgeTimeStamp;
+
+		/* Hand the period to the main loop for RPM, every tooth is evenly spaced so no need for sync */
+		PUBLISH_TOOTH_PERIOD(timeBetweenSuccessivePrimaryPulses);
 
 		// don't run until the second trigger has come in and the period is correct (VERY temporary)
 		if(!(coreStatusA & PRIMARY_SYNC)){
 			primaryTeethDroppedFromLackOfSync++;
+			COUNT_TOOTH_BEFORE_SYNC();
 			return;
 		}
-
-		LongTime timeStamp;
-
-		/* Install the low word */
-		timeStamp.timeShorts[1] = edgeTimeStamp;
-		/* Find out what our timer value means and put it in the high word */
-		if(TFLGOF && !(edgeTimeStamp & 0x8000)){ /* see 10.3.5 paragraph 4 of 68hc11 ref manual for details */
-			timeStamp.timeShorts[0] = timerExtensionClock + 1;
-		}else{
-			timeStamp.timeShorts[0] = timerExtensionClock;
-		}
-
-		// temporary data from inputs
-		primaryLeadingEdgeTimeStamp = timeStamp.timeLong;
-		timeBetweenSuccessivePrimaryPulses = lastPrimaryPulseTimeStamp - primaryLeadingEdgeTimeStamp;
-		lastPrimaryPulseTimeStamp = primaryLeadingEdgeTimeStamp;
+		currentWheelEvent = primaryPulsesPerSecondaryPulse - 1;
+		wheelEventTimeStamp = timeStamp.timeLong;
 //		timeBetweenSuccessivePrimaryPulsesBuffer = (timeBetweenSuccessivePrimaryPulses >> 1) + (timeBetweenSuccessivePrimaryPulsesBuffer >> 1);
 
 		// TODO make scheduling either fixed from boot with a limited range, OR preferrably if its practical scheduled on the fly to allow arbitrary advance and retard of both fuel and ignition.
@@ -154,21 +174,7 @@ void PrimaryRPMISR(){
 			return;
 		}
 
-		// CAUTION came to me lying in bed half asleep idea :
-
-		// TODO move tooth selection to the calc loop in main such that this routine just iterates through an array of events and schedules those that are destined for this tooth.
-
-		// if ign enabled
-			// iterate through ignition first, schedule all of those
-			// iterate through dwell next, schedule all of those
-		// if fuel enabled
-			// iterate through main fuel next, schedule all of those
-			// if staging enabled and required
-				// iterate through staged fuel last,
-
-		// TODO should make for a clean compact scheduling implementation. the fuel code doesn't care when/how it has started in the past, and hopefully ign will be the same.
-
-		// this will be done with an array and per tooth check in future
+		// ADC readings on alternate teeth, TODO move this to an event list too
 		if((primaryPulsesPerSecondaryPulse % 2) == 0){
 
 			// TODO sample ADCs on teeth other than that used by the scheduler in order to minimise peak run time and get clean signals
@@ -181,179 +187,20 @@ void PrimaryRPMISR(){
 
 			/* Reset the clock for reading timeout */
 			Clocks.timeoutADCreadingClock = 0;
-
-			if(masterPulseWidth > injectorMinimumPulseWidth){ // use reference PW to decide. spark needs moving outside this area though TODO
-				/* Determine if half the cycle is bigger than short-max */
-				unsigned short maxAngleAfter;
-				if((engineCyclePeriod >> 1) > 0xFFFF){
-					maxAngleAfter = 0xFFFF;
-				}else{
-					maxAngleAfter = (unsigned short)(engineCyclePeriod >> 1);
-				}
-
-				/* Check advance to ensure it is less than 1/2 of the previous engine cycle and more than codetime away */
-				unsigned short advance;
-				if(totalAngleAfterReferenceInjection > maxAngleAfter){ // if too big, make it max
-					advance = maxAngleAfter;
-				}else if(totalAngleAfterReferenceInjection < trailingEdgeSecondaryRPMInputCodeTime){ // if too small, make it min
-					advance = trailingEdgeSecondaryRPMInputCodeTime;
-				}else{ // else use it as is
-					advance = totalAngleAfterReferenceInjection;
-				}
-
-				// determine the long and short start times
-				unsigned short startTime = primaryLeadingEdgeTimeStamp + advance;
-				unsigned long startTimeLong = timeStamp.timeLong + advance;
-
-				/* Determine the channels to schedule */
-				unsigned char fuelChannel = (primaryPulsesPerSecondaryPulse / 2) - 1;
-				unsigned char ignitionChannel = (primaryPulsesPerSecondaryPulse / 2) - 1;
-
-				if(fuelChannel > 5 || ignitionChannel > 5){
-//					send("bad fuel : ");
-	//				sendUC(fuelChannel);
-		//			send("bad  ign : ");
-			//		sendUC(ignitionChannel);
-					return;
-				}
-
-				// determine whether or not to reschedule
-				unsigned char reschedule = 0;
-				unsigned long diff = startTimeLong - (injectorMainEndTimes[fuelChannel] + injectorSwitchOffCodeTime);
-				if(diff > LONGHALF){
-					reschedule = 1;
-				}
-
-				// schedule the appropriate channel
-				if(!(*injectorMainControlRegisters[fuelChannel] & injectorMainEnableMasks[fuelChannel]) || reschedule){ /* If the timer isn't still running, or if its set too long, set it to start again at the right time soon */
-					*injectorMainControlRegisters[fuelChannel] |= injectorMainEnableMasks[fuelChannel];
-					*injectorMainTimeRegisters[fuelChannel] = startTime;
-					TIE |= injectorMainOnMasks[fuelChannel];
-					TFLG = injectorMainOnMasks[fuelChannel];
-				}else{
-					injectorMainStartTimesHolding[fuelChannel] = startTime;
-					selfSetTimer |= injectorMainOnMasks[fuelChannel]; // setup a bit to let the timer interrupt know to set its own new start from a var
-				}
-
-				// TODO advance/retard/dwell numbers all need range checking etc done. some of this should be done in the calculator section, and some here. currently none is done at all and for that reason, this will not work in a real system yet, if it works at all.
-				// as do array indexs here and in the ISRs...
-
-
-				// TODO implement mechanism for dropping a cylinder in event of over queueing or spark cut/round robin
-				// important as ignition sequence disrupted when this occurs as it stands.
-
-				// TODO check queue length checks to ensure we dont count up to somewhere we can never count down from. This could be causing the hanging long phenomina
-
-				// DWELL
-/*
-				// If dwell is not currently enabled, set it all up
-				if(!(PITCE & DWELL_ENABLE)){
-					// Schedule Dwell event (do this first because it comes earliest.
-					// set the channel to fire
-					nextDwellChannel = ignitionChannel;
-
-					// set the time
-					PITLD0 = advance;
-					//				PITLD0 = ignitionAdvances[ignitionChannel] - *currentDwellRealtime; BAD for various reasons!
-
-					// clear the flags first as they apparently become set any old time whether enabled or not.
-					PITTF |= DWELL_ENABLE;
-
-					// turn on the ints
-					PITINTE |= DWELL_ENABLE;
-
-					// clear the flags first as they apparently become set any old time whether enabled or not.
-					PITTF |= DWELL_ENABLE;
-
-					// enable channels
-					PITCE |= DWELL_ENABLE;
-				}else if(dwellQueueLength == 0){
-					// load time offset such that next period is correct
-					PITLD0 = (advance - PITCNT0);
-
-					// increment queue length
-					dwellQueueLength++;
-				}else if(dwellQueueLength > fixedConfigs1.engineSettings.combustionEventsPerEngineCycle){ //TODO sensible figures here for array index OOBE
-					// do nothing, or increment a counter or something similar.
-				}else{
-					unsigned short sumOfDwells = PITLD0;
-					// add up the prequeued time periods
-
-					// queue = 1 pitld is all
-					// queue = 2 one from 0 index of array AND pitld
-
-					unsigned char index = 0;
-					while(index < (dwellQueueLength -1)){
-						sumOfDwells += queuedDwellOffsets[index];
-						index++;
-					}
-					//				for(index = 0;index < (dwellQueueLength -1);index++){ // is this right?
-					//					sumOfDwells += queuedDwellOffsets[index];
-					//				}
-
-					// store time offset in appropriate array location
-					queuedDwellOffsets[dwellQueueLength - 1] = advance - (PITCNT0 + sumOfDwells);
-
-					// increment queue length from one or more
-					dwellQueueLength++;
-				}
-
-				// IGNITION experimental stuff
-
-				// If ignition is not currently enabled, set it all up
-				if(!(PITCE & IGNITION_ENABLE)){
-					// Schedule Ignition event (do this first because it comes earliest.
-					// set the channel to fire
-					nextIgnitionChannel = ignitionChannel;
-
-					// figure out the time to set the delay reg to
-					PITLD1 = advance + injectorMainPulseWidthsRealtime[fuelChannel];
-					//				PITLD1 = ignitionAdvances[ignitionChannel + outputBankIgnitionOffset];
-
-					// clear the flags first as they apparently become set any old time whether enabled or not.
-					PITTF |= IGNITION_ENABLE;
-
-					// turn on the ints
-					PITINTE |= IGNITION_ENABLE;
-
-					// clear the flags first as they apparently become set any old time whether enabled or not.
-					PITTF |= IGNITION_ENABLE;
-
-					// enable channels
-					PITCE |= IGNITION_ENABLE;
-				}else if(ignitionQueueLength == 0){
-					// load timer register
-					PITLD1 = ((advance + injectorMainPulseWidthsRealtime[fuelChannel]) - PITCNT1);
-
-					// increment to 1
-					ignitionQueueLength++;
-				}else if(ignitionQueueLength > fixedConfigs1.engineSettings.combustionEventsPerEngineCycle){ //TODO sensible figures here for array index OOBE
-					// do nothing, or increment a counter or something similar.
-				}else{
-					unsigned short sumOfIgnitions = PITLD1;
-					// add up the prequeued time periods
-
-					// queue = 1 pitld is all
-					// queue = 2 one from 0 index of array AND pitld
-
-
-					unsigned char index = 0;
-					while(index < (ignitionQueueLength - 1)){
-						sumOfIgnitions += queuedIgnitionOffsets[index];
-						index++;
-					}
-					//	for(index = 0;index < (ignitionQueueLength -1);index++){ // is this right?
-					// 		sumOfIgnitions += queuedIgnitionOffsets[index];
-					//	}
-
-					// store time offset in appropriate array location
-					queuedIgnitionOffsets[ignitionQueueLength - 1] = advance - (PITCNT1 + sumOfIgnitions);
-
-					// increment from 1 or more
-					ignitionQueueLength++;
-				}*/
-			}
 		}
+
+		/* Arm whatever the main loop compiled for this tooth */
+		scheduleOutputEvents(currentWheelEvent, timeStamp.timeLong);
+
+		// TODO advance/retard/dwell numbers all need range checking etc done. some of this should be done in the calculator section, and some here. currently none is done at all and for that reason, this will not work in a real system yet, if it works at all.
+		// as do array indexs here and in the ISRs...
+
+
+		// TODO implement mechanism for dropping a cylinder in event of over queueing or spark cut/round robin
+		// important as ignition sequence disrupted when this occurs as it stands.
+
+		// TODO check queue length checks to ensure we dont count up to somewhere we can never count down from. This could be causing the hanging long phenomina
+
 		RuntimeVars.primaryInputLeadingRuntime = TCNT - codeStartTimeStamp;
 	}else{
 		RuntimeVars.primaryInputTrailingRuntime = TCNT - codeStartTimeStamp;
@@ -376,11 +223,11 @@ void PrimaryRPMISR(){
  */
 void SecondaryRPMISR(){
 	/* Clear the interrupt flag for this input compare channel */
-	TFLG = 0x02;
+	TFLG = 0x20;
 
 	/* Save all relevant available data here */
 	unsigned short codeStartTimeStamp = TCNT;		/* Save the current timer count */
-	unsigned short edgeTimeStamp = TC1;				/* Save the timestamp */
+	unsigned short edgeTimeStamp = TC5;				/* Save the timestamp */
 	unsigned char PTITCurrentState = PTIT;			/* Save the values on port T regardless of the state of DDRT */
 //	unsigned short PORTS_BACurrentState = PORTS_BA;	/* Save ignition output state */
 
@@ -393,16 +240,20 @@ void SecondaryRPMISR(){
 	 * filter should be matched to that width as should the hardware filter.
 	 */
 
+	LongTime timeStamp;
+
+	EXTEND_TIME_STAMP(timeStamp, edgeTimeStamp);
+	LOG_TRIGGER_EDGE(timeStamp.timeLong, TRIGGER_LOG_SECONDARY, PTITCurrentState);
+
 	/* The LM1815 variable reluctance sensor amplifier allows the output to be
 	 * pulled high starting at the center of a tooth. So, what we see as the
 	 * start of a tooth is actually the centre of a physical tooth. Because
 	 * tooth shape, profile and spacing may vary this is the only reliable edge
 	 * for us to schedule from, hence the trailing edge code is very simple.
 	 */
-	if(PTITCurrentState & 0x02){
-// was this code like this because of a good reason?
-//		primaryPulsesPerSecondaryPulseBuffer = primaryPulsesPerSecondaryPulse;
-		primaryPulsesPerSecondaryPulse = 0;
+	if(PTITCurrentState & 0x20){
+		/* Measured against the crank before this edge resets the tooth count */
+		CAPTURE_CAM_EDGE(timeStamp.timeLong);
 
 		// if we didn't get the right number of pulses drop sync and start over
 		if((primaryPulsesPerSecondaryPulse != 12) && (coreStatusA & PRIMARY_SYNC)){
@@ -410,16 +261,10 @@ void SecondaryRPMISR(){
 			Counters.crankSyncLosses++;
 		}
 
-		LongTime timeStamp;
-
-		/* Install the low word */
-		timeStamp.timeShorts[1] = edgeTimeStamp;
-		/* Find out what our timer value means and put it in the high word */
-		if(TFLGOF && !(edgeTimeStamp & 0x8000)){ /* see 10.3.5 paragraph 4 of 68hc11 ref manual for details */
-			timeStamp.timeShorts[0] = timerExtensionClock + 1;
-		}else{
-			timeStamp.timeShorts[0] = timerExtensionClock;
-		}
+// was this code like this because of a good reason?
+//		primaryPulsesPerSecondaryPulseBuffer = primaryPulsesPerSecondaryPulse;
+		/* Only cleared once checked, clearing it first made every secondary pulse look like a miscount */
+		primaryPulsesPerSecondaryPulse = 0;
 
 		// get the data we actually want
 		engineCyclePeriod = 2 * (timeStamp.timeLong - lastSecondaryOddTimeStamp); // save the engine cycle period
@@ -427,6 +272,8 @@ void SecondaryRPMISR(){
 
 		// Because this is our only reference, each time we get this pulse, we know where we are at (simple mode so far)
 		coreStatusA |= PRIMARY_SYNC;
+		/* The tooth before this pulse was the last of the twelve */
+		RECORD_FIRST_SYNC(numberOfWheelEvents - 1);
 		RuntimeVars.secondaryInputLeadingRuntime = TCNT - codeStartTimeStamp;
 	}else{
 		RuntimeVars.secondaryInputTrailingRuntime = TCNT - codeStartTimeStamp;
@@ -45,12 +45,30 @@
  */
 
 
+#define DECODER_IMPLEMENTATION_C
 #include "inc/FreeMS2.h"
 #include "inc/interrupts.h"
 #include "inc/decoderInterface.h"
+#include "inc/outputScheduler.h"
 #include "inc/utils.h"
 
 
+/** Decoder init
+ *
+ * One input pulse per combustion event, so that many periods per cycle, and
+ * the one wheel event repeats every combustion event.
+ */
+void decoderInitPreliminary(){
+	RPMDividend = (ticksPerCycleAtOneRPMx2 / fixedConfigs1.engineSettings.combustionEventsPerEngineCycle) * fixedConfigs1.decoderSettings.RPMAveragingTeeth;
+
+	numberOfWheelEvents = 1;
+	wheelEventCycleAngle = ENGINE_CYCLE_ANGLE / fixedConfigs1.engineSettings.combustionEventsPerEngineCycle;
+	wheelEventAngles[0] = 0;
+	toothPeriodAngle = wheelEventCycleAngle;
+	outputCycleAngle = wheelEventCycleAngle;
+}
+
+
 /** Primary RPM ISR
  *
  * Schedule events :
@@ -81,29 +99,25 @@ void PrimaryRPMISR(){
 	/* Calculate the latency in ticks */
 	ISRLatencyVars.primaryInputLatency = codeStartTimeStamp - edgeTimeStamp;
 
-	if(PTITCurrentState & 0x01){
-		Counters.primaryTeethSeen++;
+	LongTime timeStamp;
 
-		LongTime timeStamp;
+	EXTEND_TIME_STAMP(timeStamp, edgeTimeStamp);
+	REJECT_PRIMARY_NOISE(PTITCurrentState & 0x01, timeStamp.timeLong, lastPrimaryPulseTimeStamp, PTITCurrentState);
+	FEED_STALL_WATCHDOG();
+	LOG_TRIGGER_EDGE(timeStamp.timeLong, TRIGGER_LOG_PRIMARY, PTITCurrentState);
 
-		/* Install the low word */
-		timeStamp.timeShorts[1] = edgeTimeStamp;
-		/* Find out what our timer value means and put it in the high word */
-		if(TFLGOF && !(edgeTimeStamp & 0x8000)){ /* see 10.3.5 paragraph 4 of 68hc11 ref manual for details */
-			timeStamp.timeShorts[0] = timerExtensionClock + 1;
-		}else{
-			timeStamp.timeShorts[0] = timerExtensionClock;
-		}
+	if(PTITCurrentState & 0x01){
+		Counters.primaryTeethSeen++;
 
 		// temporary data from inputs
 		primaryLeadingEdgeTimeStamp = timeStamp.timeLong;
 		timeBetweenSuccessivePrimaryPulses = primaryLeadingEdgeTimeStamp - lastPrimaryPulseTimeStamp;
 		lastPrimaryPulseTimeStamp = primaryLeadingEdgeTimeStamp;
 
-// = 60 * (1000000 / 0.8)
-#define ticksPerMinute   75000000 // this is correct.
-
-		*RPMRecord = (unsigned short) (ticksPerMinute / timeBetweenSuccessivePrimaryPulses);
+		/* Hand the period to the main loop for RPM */
+		PUBLISH_TOOTH_PERIOD(timeBetweenSuccessivePrimaryPulses);
+		currentWheelEvent = 0;
+		wheelEventTimeStamp = timeStamp.timeLong;
 
 		// TODO sample ADCs on teeth other than that used by the scheduler in order to minimise peak run time and get clean signals
 		sampleEachADC(ADCArrays);
@@ -116,50 +130,8 @@ void PrimaryRPMISR(){
 		/* Reset the clock for reading timeout */
 		Clocks.timeoutADCreadingClock = 0;
 
-		if(masterPulseWidth > injectorMinimumPulseWidth){ // use reference PW to decide. spark needs moving outside this area though TODO
-			/* Determine if half the cycle is bigger than short-max */
-			unsigned short maxAngleAfter;
-			if((engineCyclePeriod >> 1) > 0xFFFF){
-				maxAngleAfter = 0xFFFF;
-			}else{
-				maxAngleAfter = (unsigned short)(engineCyclePeriod >> 1);
-			}
-
-			/* Check advance to ensure it is less than 1/2 of the previous engine cycle and more than codetime away */
-			unsigned short advance;
-			if(totalAngleAfterReferenceInjection > maxAngleAfter){ // if too big, make it max
-				advance = maxAngleAfter;
-			}else if(totalAngleAfterReferenceInjection < trailingEdgeSecondaryRPMInputCodeTime){ // if too small, make it min
-				advance = trailingEdgeSecondaryRPMInputCodeTime;
-			}else{ // else use it as is
-				advance = totalAngleAfterReferenceInjection;
-			}
-
-			// determine the long and short start times
-			unsigned short startTime = edgeTimeStamp + advance;
-			unsigned long startTimeLong = timeStamp.timeLong + advance;
-
-			/* Determine the channels to schedule */
-			unsigned char fuelChannel = 0;//(primaryPulsesPerSecondaryPulse / 2) - 1;
-
-			// determine whether or not to reschedule
-			unsigned char reschedule = 0;
-			unsigned long diff = startTimeLong - (injectorMainEndTimes[fuelChannel] + injectorSwitchOffCodeTime);
-			if(diff > LONGHALF){
-				reschedule = 1;
-			}
-
-			// schedule the appropriate channel
-			if(!(*injectorMainControlRegisters[fuelChannel] & injectorMainEnableMasks[fuelChannel]) || reschedule){ /* If the timer isn't still running, or if its set too long, set it to start again at the right time soon */
-				*injectorMainControlRegisters[fuelChannel] |= injectorMainEnableMasks[fuelChannel];
-				*injectorMainTimeRegisters[fuelChannel] = startTime;
-				TIE |= injectorMainOnMasks[fuelChannel];
-				TFLG = injectorMainOnMasks[fuelChannel];
-			}else{
-				injectorMainStartTimesHolding[fuelChannel] = startTime;
-				selfSetTimer |= injectorMainOnMasks[fuelChannel]; // setup a bit to let the timer interrupt know to set its own new start from a var
-			}
-		}
+		/* Arm whatever the main loop compiled for this event */
+		scheduleOutputEvents(currentWheelEvent, timeStamp.timeLong);
 		RuntimeVars.primaryInputLeadingRuntime = TCNT - codeStartTimeStamp;
 	}else{
 		RuntimeVars.primaryInputTrailingRuntime = TCNT - codeStartTimeStamp;
@@ -173,11 +145,11 @@ void PrimaryRPMISR(){
  */
 void SecondaryRPMISR(){
 	/* Clear the interrupt flag for this input compare channel */
-	TFLG = 0x02;
+	TFLG = 0x20;
 
 	/* Save all relevant available data here */
 	unsigned short codeStartTimeStamp = TCNT;		/* Save the current timer count */
-	unsigned short edgeTimeStamp = TC1;				/* Save the timestamp */
+	unsigned short edgeTimeStamp = TC5;				/* Save the timestamp */
 	unsigned char PTITCurrentState = PTIT;			/* Save the values on port T regardless of the state of DDRT */
 //	unsigned short PORTS_BACurrentState = PORTS_BA;	/* Save ignition output state */
 
@@ -192,14 +164,8 @@ void SecondaryRPMISR(){
 
 	LongTime timeStamp;
 
-	/* Install the low word */
-	timeStamp.timeShorts[1] = edgeTimeStamp;
-	/* Find out what our timer value means and put it in the high word */
-	if(TFLGOF && !(edgeTimeStamp & 0x8000)){ /* see 10.3.5 paragraph 4 of 68hc11 ref manual for details */
-		timeStamp.timeShorts[0] = timerExtensionClock + 1;
-	}else{
-		timeStamp.timeShorts[0] = timerExtensionClock;
-	}
+	EXTEND_TIME_STAMP(timeStamp, edgeTimeStamp);
+	LOG_TRIGGER_EDGE(timeStamp.timeLong, TRIGGER_LOG_SECONDARY, PTITCurrentState);
 
 	/* The LM1815 variable reluctance sensor amplifier allows the output to be
 	 * pulled high starting at the center of a tooth. So, what we see as the
@@ -207,8 +173,9 @@ void SecondaryRPMISR(){
 	 * tooth shape, profile and spacing may vary this is the only reliable edge
 	 * for us to schedule from, hence the trailing edge code is very simple.
 	 */
-	if(PTITCurrentState & 0x02){
+	if(PTITCurrentState & 0x20){
 		Counters.secondaryTeethSeen++;
+		CAPTURE_CAM_EDGE(timeStamp.timeLong);
 
 		/* leading code
 		 *
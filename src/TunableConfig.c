@@ -54,7 +54,7 @@ const volatile SmallTables1 SmallTablesAFlash  TUNETABLESD = {
 		{ARRAY_OF_16_TEMPS, ARRAY_OF_16_ZEROS},       	/* engineTempEnrichmentTableFixed */
 		{ARRAY_OF_16_TEMPS, ARRAY_OF_16_ZEROS},       	/* primingVolumeTable */
 		{ARRAY_OF_16_TEMPS,  ARRAY_OF_16_PERCENTS},      	/* engineTempEnrichmentTablePercent */
-		{ARRAY_OF_16_ZEROS, ARRAY_OF_16_RPMS},       	/* dwellMaxVersusRPMTable */
+		{ARRAY_OF_16_RPMS, ARRAY_OF_16_MAX_DWELLS},  	/* dwellMaxVersusRPMTable */
 		{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
@@ -70,6 +70,7 @@ const volatile SmallTables1 SmallTablesAFlash  TUNETABLESD = {
 const volatile SmallTables2 SmallTablesBFlash TUNETABLESD = {
 		asyncDatalogBasic,
 		ARRAY_OF_6_FUEL_TRIMS,	/* perCylinderFuelTrims[] */
+		ARRAY_OF_60_ZEROS,   	/* toothAngleCorrections[] */
 		{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
@@ -53,7 +53,7 @@ const volatile SmallTables1 SmallTablesAFlash2 TUNETABLESD = {
 		{ARRAY_OF_16_ZEROS, ARRAY_OF_16_ZEROS},       	/* engineTempEnrichmentTableFixed */
 		{ARRAY_OF_16_ZEROS, ARRAY_OF_16_ZEROS},       	/* primingVolumeTable */
 		{ARRAY_OF_16_ZEROS,  ARRAY_OF_16_ZEROS},      	/* engineTempEnrichmentTablePercent */
-		{ARRAY_OF_16_ZEROS, ARRAY_OF_16_RPMS},       	/* dwellMaxVersusRPMTable */
+		{ARRAY_OF_16_RPMS, ARRAY_OF_16_MAX_DWELLS},  	/* dwellMaxVersusRPMTable */
 		{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
@@ -69,6 +69,7 @@ const volatile SmallTables1 SmallTablesAFlash2 TUNETABLESD = {
 const volatile SmallTables2 SmallTablesBFlash2 TUNETABLESD = {
 		asyncDatalogBasic,
 		ARRAY_OF_6_FUEL_TRIMS,	/* perCylinderFuelTrims[] */
+		ARRAY_OF_60_ZEROS,   	/* toothAngleCorrections[] */
 		{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
@@ -51,9 +51,17 @@
 #include "inc/blockDetailsLookup.h"
 #include "inc/commsCore.h"
 #include "inc/init.h"
+#include "inc/decoderInterface.h"
 #include <string.h>
 
 
+/* Header, payload ID, payload length, lost count, the records themselves and a checksum */
+#define TRIGGER_LOG_PACKET_SIZE (6 + (TRIGGER_LOG_RECORDS_PER_PACKET * 5) + 1)
+static unsigned char triggerLogPacket[TRIGGER_LOG_PACKET_SIZE];
+static unsigned short triggerLogTail;	/* Count of records consumed, compared with triggerLogHead */
+static unsigned char triggerLogRecordsLostSinceLast;	/* Since the last packet, saturates rather than wrapping */
+
+
 /** @brief Populate a basic datalog packet
  *
  * Copies various chunks of data to the transmission buffer and truncates to
@@ -225,6 +233,97 @@
 //}
 
 
+/** @brief Send a trigger log packet
+ *
+ * Drain up to TRIGGER_LOG_RECORDS_PER_PACKET edges from the trigger log into
+ * a packet of their own and start it on its way. The RPM ISRs never wait for
+ * this code, so any records they overwrite before or during the copy are
+ * counted as lost and the count is sent at the front of the next packet.
+ * The sixteen bit counts can't be lapped while the stream keeps up, and the
+ * stream starts from the newest edge when it is selected, see
+ * decodePacketAndRespond(), so edges logged while nobody listened are ignored.
+ *
+ * Only call this when the serial port is not already transmitting.
+ *
+ * @author Fred Cooke
+ */
+void sendTriggerLog(){
+	/* Single word read, so no need to lock out the ISRs */
+	unsigned short available = triggerLogHead - triggerLogTail;
+	if(available == 0){
+		return;
+	}
+
+	/* Skip over whatever has already been overwritten */
+	unsigned short overwritten = 0;
+	if(available > TRIGGER_LOG_LENGTH){
+		overwritten = available - TRIGGER_LOG_LENGTH;
+		triggerLogTail += overwritten;
+		available = TRIGGER_LOG_LENGTH;
+	}
+	if(available > TRIGGER_LOG_RECORDS_PER_PACKET){
+		available = TRIGGER_LOG_RECORDS_PER_PACKET;
+	}
+
+	unsigned char* position = triggerLogPacket;
+	*position = HEADER_HAS_LENGTH;
+	position++;
+	*((unsigned short*)position) = asyncTriggerLogPacket;
+	position += 2;
+	*((unsigned short*)position) = 1 + (available * 5);
+	position += 2;
+	unsigned char* lostPosition = position;
+	position++;
+
+	unsigned char i;
+	for(i = 0;i < available;i++){
+		triggerLogRecord* record = &triggerLog[(triggerLogTail + i) & (TRIGGER_LOG_LENGTH - 1)];
+		*((unsigned long*)position) = record->timeStamp;
+		position += 4;
+		*position = record->edgeInfo;
+		position++;
+	}
+
+	/* If the ISRs lapped us during the copy some of the above is newer than it should be, drop the lot */
+	if((unsigned short)(triggerLogHead - triggerLogTail) > TRIGGER_LOG_LENGTH){
+		overwritten += available;
+		available = 0;
+	}
+	triggerLogTail += available;
+
+	Counters.triggerLogRecordsLost += overwritten;
+	if(overwritten > (ONES - triggerLogRecordsLostSinceLast)){
+		triggerLogRecordsLostSinceLast = ONES;
+	}else{
+		triggerLogRecordsLostSinceLast += overwritten;
+	}
+	if(available == 0){
+		return;
+	}
+
+	*lostPosition = triggerLogRecordsLostSinceLast;
+	triggerLogRecordsLostSinceLast = 0;
+
+	/* Tag the checksum on the end */
+	unsigned short length = (unsigned short)position - (unsigned short)triggerLogPacket;
+	*position = checksum(triggerLogPacket, length);
+	length++;
+
+	TXBufferCurrentPositionSCI0 = triggerLogPacket;
+	TXPacketLengthToSendSCI0 = length;
+	Counters.datalogsSent++;
+
+	/* Initiate transmission */
+	SCI0DRL = START_BYTE;
+	while(!(SCI0SR1 & 0x80)){/* Wait for ever until able to send then move on */}
+	SCI0DRL = START_BYTE; // nasty hack that works... means at least one and most 2 starts are sent so stuff works, but is messy... there must be a better way.
+
+	/* Note : Order Is Important! */
+	/* TX empty flag is already set, so we must clear it by writing out before enabling the interrupt */
+	SCI0CR2 |= SCICR2_TX_ISR_ENABLE;
+}
+
+
 /** @brief Decode a packet and respond
  *
  * This is the core function that controls which functionality is run when a
@@ -234,6 +333,23 @@
  * @author Fred Cooke
  */
 void decodePacketAndRespond(){
+	/* Act on the async datalog type request, everything is still echoed back as is */
+	unsigned char* payload = RXBuffer + 3;
+	if(RXBuffer[0] & HEADER_HAS_SEQUENCE){
+		payload++;
+	}
+	if(RXBuffer[0] & HEADER_HAS_LENGTH){
+		payload += 2;
+	}
+	if((*((unsigned short*)(RXBuffer + 1)) == setAsyncDatalogType) && (payload < (RXBuffer + RXPacketLengthReceived - 1))){
+		/* A fresh trigger stream starts from the newest edge, not from whatever piled up before it */
+		if((*payload == asyncDatalogTrigger) && (asyncDatalogType != asyncDatalogTrigger)){
+			triggerLogTail = triggerLogHead;
+			triggerLogRecordsLostSinceLast = 0;
+		}
+		asyncDatalogType = *payload;
+	}
+
 	TXBufferCurrentPositionSCI0 = RXBuffer;
 	TXPacketLengthToSendSCI0 = RXPacketLengthReceived;
 
@@ -38,7 +38,9 @@
 
 #define COREVARSGENERATOR_C
 #include "inc/FreeMS2.h"
+#include "inc/interrupts.h"
 #include "inc/commsCore.h"
+#include "inc/utils.h"
 #include "inc/coreVarsGenerator.h"
 #include "inc/decoderInterface.h"
 
@@ -263,12 +265,24 @@ void generateCoreVars(){
 
 
 	/* Get RPM by locking out ISRs for a second and grabbing the Tooth logging data */
-	//atomic start
-	// copy rpm data
-	//atomic end
+	ATOMIC_START(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+	unsigned long localToothPeriodSum = toothPeriodSum;
+	ATOMIC_END(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
 
 	// Calculate RPM and delta RPM and delta delta RPM from data recorded
-	CoreVars->RPM = *RPM; // temporary!!
+	CoreVars->RPM = periodToRPM(RPMDividend, localToothPeriodSum);
+
+	/* Predict how soon the next real tooth could possibly arrive */
+	unsigned long localNoiseWindow = periodToNoiseWindow(localToothPeriodSum);
+	/* And how long without any tooth means it has stopped */
+	unsigned short localStallTimeout = periodToStallTimeout(localToothPeriodSum);
+	ATOMIC_START(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+	primaryNoiseWindow = localNoiseWindow;
+	toothStallTimeout = localStallTimeout;
+	ATOMIC_END(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+
+	/* Bring the cam phases up to date with whatever edges came in since last time */
+	camEdgesToPhases();
 	unsigned short localDRPM = 0;
 	unsigned short localDDRPM = 0;
 
@@ -48,9 +48,11 @@
  * order variables such as load, VE, Lamdda, Transient fuel correction, engine
  * temperature enrichment, Injector dead time, etc.
  *
+ * Only injector dead time is generated so far, the rest waits on the tables.
+ *
  * @author Fred Cooke
  */
-//void generateDerivedVars(){
+void generateDerivedVars(){
 //	/*&&&&&&&&&&&&&&&&&&&& Use basic variables to lookup and calculate derived variables &&&&&&&&&&&&&&&&&&&*/
 //
 //
@@ -76,8 +78,8 @@
 //	DerivedVars->Lambda = lookupPagedMainTableCellValue((mainTable*)&TablesD.LambdaTable, CoreVars->RPM, DerivedVars->LoadMain, currentFuelRPage);
 //
 //
-//	/* Look up injector dead time with battery voltage */
-//	DerivedVars->IDT = lookupTwoDTableUS((twoDTableUS*)&TablesA.SmallTablesA.injectorDeadTimeTable, CoreVars->BRV);
+	/* Look up injector dead time with battery voltage */
+	DerivedVars->IDT = lookupInjectorDeadTime(CoreVars->BRV);
 //
 //
 //	/* Look up the engine temperature enrichment percentage with temperature */
@@ -137,4 +139,98 @@
 //	CoreVars->DDRPM = breakout2.timeShorts[1];
 //
 //	/*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
-//}
+}
+
+
+/* The dead time table segment that the battery voltage was last in, empty until the first lookup */
+static unsigned short deadTimeSegmentLow;		/* Battery voltage at the start of the segment */
+static unsigned short deadTimeSegmentHigh;		/* Battery voltage just past the end of the segment */
+static unsigned short deadTimeAtSegmentLow;		/* Dead time in ticks at the start of the segment */
+static signed long deadTimeSlope;				/* 4096ths of a tick of dead time per mV across the segment */
+
+
+/** @brief Injector dead time for the battery voltage
+ *
+ * Battery voltage moves slowly, so rather than search and divide through the
+ * whole table each time, the segment the voltage is in is cached with its
+ * slope. While the voltage stays inside it the dead time is one multiply away.
+ * The table is searched again only once the voltage leaves the segment. Off
+ * either end of the table the end value is held. The table is already in
+ * timer ticks.
+ *
+ * @author Fred Cooke
+ *
+ * @param BRV the battery reference voltage in mV.
+ *
+ * @return the injector dead time in timer ticks.
+ */
+unsigned short lookupInjectorDeadTime(unsigned short BRV){
+	if((BRV < deadTimeSegmentLow) || (BRV >= deadTimeSegmentHigh)){
+		twoDTableUS* table = (twoDTableUS*)&SmallTablesAFlash.injectorDeadTimeTable;
+
+		/* Find the first axis value past the voltage */
+		unsigned char index = 0;
+		while((index < TWODTABLEUS_LENGTH) && (table->Axis[index] <= BRV)){
+			index++;
+		}
+
+		if(index == 0){
+			deadTimeSegmentLow = 0;
+			deadTimeSegmentHigh = table->Axis[0];
+			deadTimeAtSegmentLow = table->Values[0];
+			deadTimeSlope = 0;
+		}else if(index == TWODTABLEUS_LENGTH){
+			deadTimeSegmentLow = table->Axis[TWODTABLEUS_LENGTH - 1];
+			deadTimeSegmentHigh = SHORTMAX;
+			deadTimeAtSegmentLow = table->Values[TWODTABLEUS_LENGTH - 1];
+			deadTimeSlope = 0;
+		}else{
+			deadTimeSegmentLow = table->Axis[index - 1];
+			deadTimeSegmentHigh = table->Axis[index];
+			deadTimeAtSegmentLow = table->Values[index - 1];
+			deadTimeSlope = (((signed long)table->Values[index] - table->Values[index - 1]) << 12) / (signed long)(deadTimeSegmentHigh - deadTimeSegmentLow);
+		}
+	}
+
+	return deadTimeAtSegmentLow + (((signed long)(BRV - deadTimeSegmentLow) * deadTimeSlope) >> 12);
+}
+
+
+/** @brief Drop the cached dead time segment
+ *
+ * The cache above is built from the table in flash, so anything that writes
+ * flash must call this, or the old segment would be used until the battery
+ * voltage happened to leave it. An empty segment makes the next lookup search.
+ *
+ * @author Fred Cooke
+ */
+void forgetInjectorDeadTimeSegment(){
+	deadTimeSegmentLow = 0;
+	deadTimeSegmentHigh = 0;
+}
+
+
+/** @brief Maximum coil dwell for the RPM
+ *
+ * @author Fred Cooke
+ *
+ * @param RPM the engine speed in RPM x 2.
+ *
+ * @return the longest dwell allowed in timer ticks.
+ */
+unsigned short lookupMaximumDwell(unsigned short RPM){
+	return lookupTwoDTableUS((twoDTableUS*)&SmallTablesAFlash.dwellMaxVersusRPMTable, RPM);
+}
+
+
+/** @brief Desired coil dwell for the battery voltage
+ *
+ * @author Fred Cooke
+ *
+ * @param BRV the battery reference voltage in mV.
+ *
+ * @return the dwell the coil wants in timer ticks.
+ */
+unsigned short lookupDesiredDwell(unsigned short BRV){
+	return lookupTwoDTableUS((twoDTableUS*)&SmallTablesAFlash.dwellDesiredVersusVoltageTable, BRV);
+}
@@ -43,6 +43,7 @@
 #include "inc/flashBurn.h"
 #include "inc/commsISRs.h"
 #include "inc/commsCore.h"
+#include "inc/derivedVarsGenerator.h"
 #include <string.h>
 
 
@@ -173,6 +174,9 @@ unsigned short writeBlock(blockDetails* details, void* buffer){
 		FlashAddress = (unsigned short*)details->FlashAddress;
 	}
 
+	/* Whatever is burned, lookups cached from the old flash contents are stale */
+	forgetInjectorDeadTimeSegment();
+
 	unsigned char i;
 	for(i=0;i<sectors;i++){
 		unsigned short errorID = writeSector(RAMPage, RAMAddress, details->FlashPage, FlashAddress);
@@ -42,6 +42,7 @@
 #include "inc/commsCore.h"
 #include "inc/tableLookup.h"
 #include "inc/decoderInterface.h"
+#include "inc/derivedVarsGenerator.h"
 #include "inc/fuelAndIgnitionCalcs.h"
 
 
@@ -186,34 +187,56 @@
 //
 //	// temporary ign tests
 //	unsigned short intendedAdvance = ADCArrays->MAT << 6;
-//	unsigned short intendedDwell = intendedAdvance >> 1;
 //
 //	short c;
 //	for(c=0;c<IGNITION_CHANNELS;c++){
 //		ignitionAdvances[IGNITION_CHANNELS] = intendedAdvance;
 //	}
-//	*currentDwellMath = intendedDwell;
-//
-////	unsigned short minPeriod = ignitionMinimumDwell << 1;
-//	//	if(intendedDwell < ignitionMinimumDwell){
-////		dwellLength = ignitionMinimumDwell;
-////	}else{
-////		dwellLength = intendedDwell;
-////	}
-////	if(intendedPeriod < minPeriod){
-////		dwellPeriod = minPeriod;
-////	}else{
-////		dwellPeriod = intendedPeriod;
-////	}
-////	PITLD0 = dwellPeriod;
 //
 //	/** @todo TODO Calculate the fuel advances (six of) */
 //	// just use one for all for now...
 //	totalAngleAfterReferenceInjection = (ADCArrays->TPS << 6);
 //
-//	/** @todo TODO Calculate the dwell period (one of) */
+//	/* The dwell period (one of) is calculated by calculateDwell() */
 //
 //	/** @todo TODO Calculate the ignition advances (twelve of) */
 //
 //	/*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&& TEMPORARY END &&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
 //}
+
+
+/** @brief Coil dwell calculation
+ *
+ * The dwell the coils want at the battery voltage, bounded by the maximum for
+ * the RPM and by the time between sparks on one coil less the time the spark
+ * needs to burn. Both tables are already in timer ticks, so the result goes
+ * straight into currentDwellMath and reaches the ISRs as a ready tick count
+ * when the banks are swapped. Too little time for a useful dwell means no
+ * dwell at all, and so no sparks.
+ *
+ * @author Fred Cooke
+ */
+void calculateDwell(){
+	unsigned short dwell = 0;
+	if((CoreVars->RPM != 0) && (outputCycleAngle != 0)){
+		dwell = lookupDesiredDwell(CoreVars->BRV);
+
+		unsigned short maximumDwell = lookupMaximumDwell(CoreVars->RPM);
+		if(dwell > maximumDwell){
+			dwell = maximumDwell;
+		}
+
+		/* Each coil fires once per output cycle */
+		unsigned long sparkPeriod = ((ticksPerCycleAtOneRPMx2 / ENGINE_CYCLE_ANGLE) * outputCycleAngle) / CoreVars->RPM;
+		if(sparkPeriod < ((unsigned long)ignitionMinimumOffTime + ignitionMinimumDwell)){
+			dwell = 0;
+		}else if(dwell > (sparkPeriod - ignitionMinimumOffTime)){
+			dwell = sparkPeriod - ignitionMinimumOffTime;
+		}
+
+		if(dwell < ignitionMinimumDwell){
+			dwell = 0;
+		}
+	}
+	*currentDwellMath = dwell;
+}
@@ -125,7 +125,10 @@ const unsigned short injectorMinimumPulseWidth = 100;
 const unsigned short ignitionMaximumDwell = 50000; /* meaningless us value for now, currently unused */
 
 /* Ignition minimum dwell in timer units */
-const unsigned short ignitionMinimumDwell = 500; /* meaningless us value for now, currently unused */
+const unsigned short ignitionMinimumDwell = 500; /* 0.4ms, any less and the coil isn't fired at all */
+
+/* Ignition minimum time from a spark to the next dwell on the same coil in timer units */
+const unsigned short ignitionMinimumOffTime = 1250; /* 1ms for the spark to burn */
 
 /* Ignition maximum delay post schedule tooth in timer units */
 const unsigned short ignitionMaximumDelayToDwellStartAfterTooth = 50000; /* (max retard) meaningless us value for now, currently unused */
@@ -165,10 +168,14 @@ const unsigned short trailingEdgeSecondaryRPMInputCodeTime = 100; /* random larg
 const unsigned short dwellStartMasks[IGNITION_CHANNELS] = { BIT8_16, BIT9_16, BIT10_16, BIT11_16, BIT12_16, BIT13_16, BIT14_16, BIT15_16, BIT0_16, BIT1_16, BIT2_16, BIT3_16};		/* Set of masks such that a cylinder can be dwelled with a single line of code */
 const unsigned short ignitionMasks[IGNITION_CHANNELS]   = {NBIT8_16,NBIT9_16,NBIT10_16,NBIT11_16,NBIT12_16,NBIT13_16,NBIT14_16,NBIT15_16,NBIT0_16,NBIT1_16,NBIT2_16,NBIT3_16};		/* Set of masks such that a cylinder can be fired with a single line of code */
 
+/* Rev limiter cut patterns, the index in sixteenths is how many bits are set, spread as evenly as possible */
+const unsigned short revLimitCutPatterns[REV_LIMIT_CUT_STEPS + 1] = {0x0000, 0x8000, 0x8080, 0x8420, 0x8888, 0x9248, 0xA4A4, 0xAA54, 0xAAAA, 0xD5AA, 0xDADA, 0xEDB6, 0xEEEE, 0xFBDE, 0xFEFE, 0xFFFE, 0xFFFF};
+
 /* Injection masks */
-const unsigned char injectorMainOnMasks[INJECTION_CHANNELS] = {BIT2,  BIT3,  BIT4,  BIT5,  BIT6,  BIT7};
-const unsigned char injectorMainOffMasks[INJECTION_CHANNELS] = {NBIT2, NBIT3, NBIT4, NBIT5, NBIT6, NBIT7};
-const unsigned char injectorMainEnableMasks[INJECTION_CHANNELS] = {0x30, 0xC0, 0x03, 0x0C, 0x30, 0xC0};
-const unsigned char injectorMainDisableMasks[INJECTION_CHANNELS] = {0xCF, 0x3F, 0xFC, 0xF3, 0xCF, 0x3F};
-const unsigned char injectorMainGoHighMasks[INJECTION_CHANNELS] = {BIT4, BIT6, BIT0, BIT2, BIT4, BIT6};
-const unsigned char injectorMainGoLowMasks[INJECTION_CHANNELS] = {NBIT4, NBIT6, NBIT0, NBIT2, NBIT4, NBIT6};
+/* These must match the INJECTORn constants in inc/injectionISRs.h which the ISRs use */
+const unsigned char injectorMainOnMasks[INJECTION_CHANNELS] = {BIT1,  BIT2,  BIT3,  BIT4,  BIT6,  BIT7};
+const unsigned char injectorMainOffMasks[INJECTION_CHANNELS] = {NBIT1, NBIT2, NBIT3, NBIT4, NBIT6, NBIT7};
+const unsigned char injectorMainEnableMasks[INJECTION_CHANNELS] = {0x0C, 0x30, 0xC0, 0x03, 0x30, 0xC0};
+const unsigned char injectorMainDisableMasks[INJECTION_CHANNELS] = {0xF3, 0xCF, 0x3F, 0xFC, 0xCF, 0x3F};
+const unsigned char injectorMainGoHighMasks[INJECTION_CHANNELS] = {BIT2, BIT4, BIT6, BIT0, BIT4, BIT6};
+const unsigned char injectorMainGoLowMasks[INJECTION_CHANNELS] = {NBIT2, NBIT4, NBIT6, NBIT0, NBIT4, NBIT6};
@@ -0,0 +1,240 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file ignitionISRs.c
+ * @ingroup interruptHandlers
+ *
+ * @brief Coil dwell and spark queues
+ *
+ * The MC9S12C128 has no PIT module and every timer channel is taken by the
+ * engine position inputs and the injectors, so coils are switched by the RTI
+ * from two queues of absolute times, one for dwell starts and one for sparks.
+ * Each is kept in time order with the soonest event last, so adding is a short
+ * insertion and taking is just a decrement. The decoders fill them through the
+ * output scheduler, which turns wheel events into 32 bit times in one go.
+ *
+ * There is no compare to spare, so each switching is carried out by the first
+ * RTI at or after its time, up to one RTI period late, in time order across
+ * both queues. Nothing is waited for inside the RTI, so the injector compares,
+ * decoder captures and serial are never held off for longer than it takes to
+ * switch what is already due.
+ *
+ * Each spark is queued along with its dwell, then retimed from the wheel event
+ * just before it, so that the prediction it fires from is at most a tooth old.
+ * A dwell that hasn't started yet moves with its spark.
+ *
+ * For cranking a spark can carry more sparks after it. Each one as it fires
+ * queues the dwell and spark for the next, so the main loop and the decoders
+ * are not involved and only a spark with more to come costs anything extra.
+ *
+ * @author Fred Cooke
+ */
+
+
+#define IGNITIONISRS_C
+#include "inc/FreeMS2.h"
+#include "inc/interrupts.h"
+#include "inc/ignitionISRs.h"
+
+
+/** @brief Put a coil switching into its place in a queue
+ *
+ * @author Fred Cooke
+ *
+ * @param queue the dwell or spark queue to add to.
+ * @param length how many events the queue holds now.
+ * @param time the extended time to switch at.
+ * @param channel the coil to switch.
+ * @param extraSparks how many more sparks follow this one.
+ *
+ * @return how many events the queue holds afterwards.
+ */
+static unsigned char insertIgnitionEvent(ignitionEvent* queue, unsigned char length, unsigned long time, unsigned char channel, unsigned char extraSparks){
+	/* Everything due sooner moves up one to stay after this */
+	unsigned char slot = length;
+	while((slot > 0) && ((queue[slot - 1].time - time) > LONGHALF)){
+		queue[slot] = queue[slot - 1];
+		slot--;
+	}
+	queue[slot].time = time;
+	queue[slot].channel = channel;
+	queue[slot].extraSparks = extraSparks;
+	return length + 1;
+}
+
+
+/** @brief Find the soonest pending switching for a coil in a queue
+ *
+ * @author Fred Cooke
+ *
+ * @param queue the dwell or spark queue to search.
+ * @param length how many events the queue holds.
+ * @param channel the coil to look for.
+ *
+ * @return the slot it is in, or length if the coil has nothing pending.
+ */
+static unsigned char findIgnitionEvent(ignitionEvent* queue, unsigned char length, unsigned char channel){
+	unsigned char slot = length;
+	while(slot > 0){
+		slot--;
+		if(queue[slot].channel == channel){
+			return slot;
+		}
+	}
+	return length;
+}
+
+
+/** @brief Take a coil switching out of a queue
+ *
+ * @author Fred Cooke
+ *
+ * @param queue the dwell or spark queue to take from.
+ * @param length how many events the queue holds now.
+ * @param slot the slot to remove.
+ *
+ * @return how many events the queue holds afterwards.
+ */
+static unsigned char removeIgnitionEvent(ignitionEvent* queue, unsigned char length, unsigned char slot){
+	length--;
+	for(;slot < length;slot++){
+		queue[slot] = queue[slot + 1];
+	}
+	return length;
+}
+
+
+/** @brief Schedule the dwell and spark for a coil
+ *
+ * A spark without its dwell is harmless, but a dwell without its spark cooks
+ * the coil, so if either queue is full neither is added and the spark is
+ * counted as dropped.
+ *
+ * @author Fred Cooke
+ *
+ * @param channel the coil to dwell and fire.
+ * @param dwellTime the extended time to start dwelling at.
+ * @param sparkTime the extended time to fire at.
+ * @param extraSparks how many more times to dwell and fire after this spark.
+ */
+void queueIgnitionEvent(unsigned char channel, unsigned long dwellTime, unsigned long sparkTime, unsigned char extraSparks){
+	if((dwellQueueLength >= IGNITION_QUEUE_LENGTH) || (ignitionQueueLength >= IGNITION_QUEUE_LENGTH)){
+		Counters.ignitionEventsDropped++;
+		return;
+	}
+	dwellQueueLength = insertIgnitionEvent(dwellQueue, dwellQueueLength, dwellTime, channel, 0);
+	ignitionQueueLength = insertIgnitionEvent(ignitionQueue, ignitionQueueLength, sparkTime, channel, extraSparks);
+}
+
+
+/** @brief Move the pending spark for a coil to a fresher time
+ *
+ * Called from the wheel event just before the spark angle. Nothing is done if
+ * the coil has no spark pending, as when it was cut or dropped with its dwell.
+ * If the dwell for that spark hasn't started yet it is moved by the same amount,
+ * otherwise a spark moved earlier than its dwell would fire first and leave the
+ * coil charging until the next cycle.
+ *
+ * @author Fred Cooke
+ *
+ * @param channel the coil about to fire.
+ * @param sparkTime the extended time to fire at.
+ */
+void retimeIgnitionEvent(unsigned char channel, unsigned long sparkTime){
+	/* Soonest first, that is the one this wheel event belongs to */
+	unsigned char slot = findIgnitionEvent(ignitionQueue, ignitionQueueLength, channel);
+	if(slot == ignitionQueueLength){
+		return;
+	}
+	unsigned long oldSparkTime = ignitionQueue[slot].time;
+	unsigned char extraSparks = ignitionQueue[slot].extraSparks;
+	ignitionQueueLength = removeIgnitionEvent(ignitionQueue, ignitionQueueLength, slot);
+	ignitionQueueLength = insertIgnitionEvent(ignitionQueue, ignitionQueueLength, sparkTime, channel, extraSparks);
+
+	/* A pending dwell due before the old spark is this spark's, a later one belongs to the next */
+	slot = findIgnitionEvent(dwellQueue, dwellQueueLength, channel);
+	if((slot != dwellQueueLength) && ((oldSparkTime - dwellQueue[slot].time) < LONGHALF)){
+		unsigned long dwellTime = dwellQueue[slot].time + (sparkTime - oldSparkTime);
+		dwellQueueLength = removeIgnitionEvent(dwellQueue, dwellQueueLength, slot);
+		dwellQueueLength = insertIgnitionEvent(dwellQueue, dwellQueueLength, dwellTime, channel, 0);
+	}
+}
+
+
+/** @brief Carry out the coil switchings that are due
+ *
+ * Called from the RTI while any are pending. The sooner of the two queues goes
+ * first, a spark before a dwell start due at the same time. A spark with more
+ * to follow queues the next dwell a gap after its own time, which the loop
+ * picks up straight away if that is already due.
+ *
+ * @author Fred Cooke
+ */
+void serviceIgnitionEvents(){
+	unsigned short timerCount = TCNT;
+	LongTime now;
+	EXTEND_TIME_STAMP(now, timerCount);
+
+	while(1){
+		unsigned char dwellDue = dwellQueueLength && ((now.timeLong - dwellQueue[dwellQueueLength - 1].time) < LONGHALF);
+		unsigned char sparkDue = ignitionQueueLength && ((now.timeLong - ignitionQueue[ignitionQueueLength - 1].time) < LONGHALF);
+		if(sparkDue && (!dwellDue || ((dwellQueue[dwellQueueLength - 1].time - ignitionQueue[ignitionQueueLength - 1].time) < LONGHALF))){
+			ignitionQueueLength--;
+			unsigned long time = ignitionQueue[ignitionQueueLength].time;
+			unsigned char channel = ignitionQueue[ignitionQueueLength].channel;
+			unsigned char extraSparks = ignitionQueue[ignitionQueueLength].extraSparks;
+			PORTS_BA &= ignitionMasks[channel];
+			dwellOn &= ignitionMasks[channel];
+
+			if(extraSparks){
+				unsigned long dwellTime = time + fixedConfigs1.schedulingSettings.multiSparkGap;
+				queueIgnitionEvent(channel, dwellTime, dwellTime + outputEventsRealtime->extraSparkDwell, extraSparks - 1);
+			}
+		}else if(dwellDue){
+			dwellQueueLength--;
+			unsigned char channel = dwellQueue[dwellQueueLength].channel;
+			PORTS_BA |= dwellStartMasks[channel];
+			dwellOn |= dwellStartMasks[channel];
+		}else{
+			return;
+		}
+	}
+}
+
+
+/** @brief Forget all coil switchings and let go of any coil still dwelling
+ *
+ * Used when the engine position is lost, as the sparks that would have ended
+ * the dwell can no longer be trusted. Must be called with interrupts off.
+ *
+ * @author Fred Cooke
+ */
+void releaseIgnitionOutputs(){
+	dwellQueueLength = 0;
+	ignitionQueueLength = 0;
+	PORTS_BA &= (unsigned short)~dwellOn;
+	dwellOn = 0;
+}
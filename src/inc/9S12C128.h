@@ -50,6 +50,8 @@
 /* http://www.ee.nmt.edu/~rison/ee308_spr06/homepage.html */
 /* extra parentheses for clarity and guarantee of precedence */
 
+/* The replay harness supplies its own versions of these four to point at a simulated register block */
+#ifndef DVUCP
 /* Dereferenced Volatile Unsigned Char Pointer */
 #define DVUCP(address) (*((volatile unsigned char*)(address)))
 /* Dereferenced Volatile Unsigned Short Pointer */
@@ -59,6 +61,7 @@
 #define AVUCP(address) ((volatile unsigned char*)(address))
 /* Address Volatile Unsigned Short Pointer */
 #define AVUSP(address) ((volatile unsigned short*)(address))
+#endif
 
 
 #define PORTS_BA DVUSP(0x0000) // TODO fix XDP512 too ??? address correct? or 0x0001?
@@ -156,6 +159,7 @@
 #define TC6 DVUSP(0x005C) /* 16 bit (0x005C TC6 (hi), 0x005D TC6 (lo)) */
 #define TC7 DVUSP(0x005E) /* 16 bit (0x005E TC7 (hi), 0x005F TC7 (lo)) */
 
+#define TC1_ADDR AVUSP(0x0052) /* 16 bit (0x0052 TC1 (hi), 0x0053 TC1 (lo)) */
 #define TC2_ADDR AVUSP(0x0054) /* 16 bit (0x0054 TC2 (hi), 0x0055 TC2 (lo)) */
 #define TC3_ADDR AVUSP(0x0056) /* 16 bit (0x0056 TC3 (hi), 0x0057 TC3 (lo)) */
 #define TC4_ADDR AVUSP(0x0058) /* 16 bit (0x0058 TC4 (hi), 0x0059 TC4 (lo)) */
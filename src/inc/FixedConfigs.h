@@ -130,6 +130,9 @@ typedef struct {
 	unsigned char revolutionsPerEngineCycle;			/* Rotary = 1, 2 Stroke = 1, 4 Stroke = 2				*/
 	unsigned char primaryTeeth;							/* How many teeth are on the crank signal including the missing ones if any (eg. 36-1 primary = 36 not 35) */
 	unsigned char missingTeeth;							/* Number sequentially removed from primary teeth (eg. 36-1 missing = 1) */
+	unsigned char gapCount;								/* How many groups of missing teeth are on the crank signal (eg. 36-1 = 1, 36-2-2-2 = 3) */
+	unsigned char gapPositions[MAXIMUM_WHEEL_GAPS];		/* Position of the first missing tooth of each gap, counting from zero including the missing ones */
+	unsigned char camTeeth;								/* How many teeth are on the cam signal per engine cycle, zero if there is no cam signal */
 } engineSetting;
 
 #define ENGINE_SETTINGS_SIZE sizeof(engineSetting)
@@ -160,7 +163,43 @@ typedef struct {
 #define SENSOR_SETTINGS_SIZE sizeof(sensorSetting)
 
 
-#define userTextFieldArrayLength1 1024 - (ENGINE_SETTINGS_SIZE + SERIAL_SETTINGS_SIZE + TACHO_SETTINGS_SIZE + 2)
+typedef struct {
+	/* Decoder settings */
+	unsigned char RPMAveragingTeeth;					/* How many tooth periods RPM is averaged over, 1 to MAXIMUM_RPM_AVERAGING_TEETH */
+	unsigned char noiseWindowFraction;					/* Primary edges closer than this many 256ths of the average tooth period are noise, 0 = off */
+	unsigned char stallTimeoutTeeth;					/* Engine is stopped if no primary edge arrives within this many average tooth periods, 0 is refused at boot */
+	unsigned char camSyncTooth;							/* Missing teeth with one cam tooth, the tooth that its edge follows, 0xFF = crank only sync */
+	unsigned char decoderType;							/* Which decoder the all decoders image runs, see below, single decoder images ignore it */
+	unsigned char gapRatioTolerance;					/* Missing teeth learned ratio mode, periods must be within this many 256ths of the learned ratio, 0 = fixed 1.5x gap test */
+} decoderSetting;
+
+#define DECODER_SETTINGS_SIZE sizeof(decoderSetting)
+
+/* Decoder types for the all decoders image, one per file in SINGLEDECODERS in the Makefile */
+#define DECODER_SIMPLE			0
+#define DECODER_NIPPON_DENSO	1
+#define DECODER_MISSING_TEETH	2
+#define DECODER_MIATA_NB		3
+#define NUMBER_OF_DECODERS		4
+
+
+typedef struct {
+	/* Scheduling settings */
+	unsigned short injectionAngles[INJECTION_CHANNELS];	/* Start of injection for each channel in engine cycle angle after the decoders first wheel event */
+	unsigned char maximumInjectorDuty;					/* 256ths of the time between pulses a channel may be open before it is over duty, 0 = no limit */
+	unsigned char overDutySplits;						/* Over duty pulses are split into this many evenly spaced shorter ones, 0 or 1 = hold the injector open instead */
+	unsigned short ignitionAngles[IGNITION_CHANNELS];	/* Spark with no advance for each coil in engine cycle angle after the decoders first wheel event */
+	unsigned short multiSparkRPM;						/* Below this RPM x 2 each spark is followed by more, for cranking, 0 = off */
+	unsigned short multiSparkGap;						/* Ticks from each of those sparks to the dwell for the next */
+	unsigned char multiSparks;							/* How many sparks per event below multiSparkRPM, 0 or 1 = just the one */
+	unsigned short revLimitRPM;							/* Above this RPM x 2 the rev limiter drops events, 0 = off */
+	unsigned char revLimitCut;							/* Sixteenths of the events dropped round robin style while limiting */
+} schedulingSetting;
+
+#define SCHEDULING_SETTINGS_SIZE sizeof(schedulingSetting)
+
+
+#define userTextFieldArrayLength1 1024 - (ENGINE_SETTINGS_SIZE + SERIAL_SETTINGS_SIZE + TACHO_SETTINGS_SIZE + DECODER_SETTINGS_SIZE + SCHEDULING_SETTINGS_SIZE + 2)
 
 /**
  * One of two structs of fixed configuration data such as physical parameters etc.
@@ -179,6 +218,10 @@ typedef struct {
 
 	tachoSetting tachoSettings;
 
+	decoderSetting decoderSettings;
+
+	schedulingSetting schedulingSettings;
+
 	/* Settings variables : 0 = false */
 	unsigned short coreSettingsA;	/* Each bit represents the state of some core setting, masks below and above where the same one is used */
 	/* Bit masks for coreSettingsA */ // TODO needs a rename, as does coreStatusA
@@ -186,14 +229,14 @@ typedef struct {
 	#define PRIMARY_POLARITY	BIT2_16		/*  2 1 = high teeth 0 = low teeth */
 	#define SECONDARY_POLARITY	BIT3_16		/*  3 1 = high teeth 0 = low teeth */
 	//#define COREA4 			BIT4_16		/*  4 */
-	//#define FUEL_CUT			BIT5_16		/*  5 Remove injection completely */
+	#define FUEL_CUT_ENABLED	BIT5_16		/*  5 Rev limiter drops injection events */
 	//#define HARD_SPARK_CUT	BIT6_16		/*  6 Remove ignition completely */
-	//#define SOFT_SPARK_CUT	BIT7_16		/*  7 Remove ignition events round robin style */
+	#define SOFT_SPARK_CUT_ENABLED	BIT7_16	/*  7 Rev limiter drops ignition events */
 	//#define SPARK_RETARD		BIT8_16		/*  8 Retard ignition in RPM dependent way */
 	#define STAGED_ON			BIT9_16		/*  9 Whether we are firing the staged injectors */
 	#define STAGED_START		BIT10_16	/* 10 1 = Fixed start 0 = Scheduled start */
 	#define STAGED_END			BIT11_16	/* 11 1 = Fixed end 0 = Scheduled end */
-	//#define COREA12			BIT12_16	/* 12 */
+	#define PREDICT_TOOTH_PERIOD	BIT12_16	/* 12 1 = Extrapolate the next tooth period 0 = Assume the last one holds */
 	//#define COREA13			BIT13_16	/* 13 */
 	//#define COREA14			BIT14_16	/* 14 */
 	//#define COREA15			BIT15_16	/* 15 */
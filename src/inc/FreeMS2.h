@@ -103,8 +103,6 @@
 
 
 // temporary test vars
-EXTERN unsigned short RPM0; // to be replaced with logging scheme for teeth.
-EXTERN unsigned short RPM1; // to be replaced with logging scheme for teeth.
 extern unsigned short tachoPeriod;
 EXTERN unsigned char portHDebounce;
 
@@ -117,8 +115,9 @@ EXTERN unsigned char portHDebounce;
 #define asyncDatalogADC			0x04
 #define asyncDatalogCircBuf		0x05
 #define asyncDatalogCircCAS		0x06
-#define asyncDatalogTrigger		0x07 // what is this
+#define asyncDatalogTrigger		0x07 /* Raw edge time stamps from both RPM inputs */
 EXTERN unsigned short configuredBasicDatalogLength;
+EXTERN unsigned char asyncDatalogType; /* Which of the above is being streamed, off by default */
 
 
 // temporary test vars
@@ -184,10 +183,11 @@ EXTERN ADCArray asyncADCArrays1;		/** secondary adc storage area for asynchronou
 
 EXTERN unsigned short* mathSampleTimeStamp; // TODO temp, remove
 EXTERN unsigned short* mathSampleTimeStampRecord; // TODO temp, remove
-EXTERN unsigned short* currentDwellMath; // TODO temp, remove
-EXTERN unsigned short* currentDwellRealtime; // TODO temp, remove
-EXTERN unsigned short currentDwell0; // TODO temp, remove
-EXTERN unsigned short currentDwell1; // TODO temp, remove
+/* Coil dwell in ticks, calculated once per calc cycle and swapped with the pulsewidths */
+EXTERN unsigned short* currentDwellMath;
+EXTERN unsigned short* currentDwellRealtime;
+EXTERN unsigned short currentDwell0;
+EXTERN unsigned short currentDwell1;
 
 /*break this on purpose so i fix it later
 #define VETablereference (*((volatile mainTable*)(0x1000)))
@@ -304,23 +304,28 @@ EXTERN unsigned short coreStatusA;	/* Each bit represents the state of some core
 #define PRIMARY_SYNC	BIT2_16		/*  2 Wasted spark/Semi sequential */
 #define SECONDARY_SYNC	BIT3_16		/*  3 COP/Full sequential */
 #define ENGINE_PHASE	BIT4_16		/*  4 For COP/Sequential, which revolution we are in, first or second */
-#define FUEL_CUT		BIT5_16		/*  5 Remove injection completely */
+#define FUEL_CUT		BIT5_16		/*  5 Rev limiter is dropping injection events round robin style */
 #define HARD_SPARK_CUT	BIT6_16		/*  6 Remove ignition completely */
-#define SOFT_SPARK_CUT	BIT7_16		/*  7 Remove ignition events round robin style */
+#define SOFT_SPARK_CUT	BIT7_16		/*  7 Rev limiter is dropping ignition events round robin style */
 #define SPARK_RETARD	BIT8_16		/*  8 Retard ignition in RPM dependent way */
 #define STAGED_REQUIRED	BIT9_16		/*  9 Fire the staged injectors */
 #define CALC_FUEL_IGN	BIT10_16	/* 10 Fuel and ignition require calculation (i.e. variables have been updated) */
 #define FORCE_READING	BIT11_16	/* 11 Flag to force ADC sampling at low rpm/stall */
-#define COREA12			BIT12_16	/* 12 */
+#define STALLED			BIT12_16	/* 12 No primary tooth inside the stall timeout, engine has stopped */
 #define COREA13			BIT13_16	/* 13 */
 #define COREA14			BIT14_16	/* 14 */
 #define COREA15			BIT15_16	/* 15 */
 #define COREA16			BIT16_16	/* 16 */
 
 #define CLEAR_PRIMARY_SYNC	NBIT2_16	/* */
+#define CLEAR_SECONDARY_SYNC	NBIT3_16	/*  3 Which revolution of the cycle this is is no longer known */
+#define CLEAR_ENGINE_PHASE	NBIT4_16	/*  4 First revolution of the cycle */
+#define CLEAR_FUEL_CUT		NBIT5_16	/*  5 Rev limiter has let go of injection */
+#define CLEAR_SOFT_SPARK_CUT	NBIT7_16	/*  7 Rev limiter has let go of ignition */
 #define STAGED_NOT_REQUIRED	NBIT9_16	/*  9 Do not fire the staged injectors */
 #define CLEAR_CALC_FUEL_IGN	NBIT10_16	/* 10 Fuel and ignition don't require calculation */
 #define CLEAR_FORCE_READING	NBIT11_16	/* 11 Clear flag to force ADC sampling at low rpm/stall */
+#define CLEAR_STALLED		NBIT12_16	/* 12 Stall has been dealt with */
 
 
 //TODO make this volatile?
@@ -330,7 +335,7 @@ unsigned short timerExtensionClock;						/* Increment for each overflow of the m
 
 
 /* For extracting 32 bit long time stamps from the overflow counter and timer registers */
-typedef union { /* Declare Union http://www.esacademy.com/faq/docs/cpointers/structures.htm */
+typedef union BIG_ENDIAN_LAYOUT { /* Declare Union http://www.esacademy.com/faq/docs/cpointers/structures.htm */
     unsigned long timeLong;
     unsigned short timeShorts[2];
 } LongTime;
@@ -340,7 +345,8 @@ typedef union { /* Declare Union http://www.esacademy.com/faq/docs/cpointers/str
 EXTERN unsigned char mainOn;				/* Keep track of where we are at for possible use as multi interrupt per injection */
 EXTERN unsigned short dwellOn;				/* Keep track of ignition output state */
 EXTERN unsigned char stagedOn;				/* Ensure we turn an injector off again if we turn it on. */
-EXTERN unsigned char selfSetTimer;			/* Set the start time of injection at the end of the last one in the channels ISR instead of the input ISR */
+EXTERN unsigned char stagedEventsPending;	/* How many of the staged event slots are in use, saves the RTI a scan when there are none */
+EXTERN stagedEvent stagedEvents[STAGED_EVENT_SLOTS];	/* Scheduled staged starts and ends, shared by all channels (init to zero required) */
 EXTERN unsigned char rescheduleFuelFlags;	/* Pulse width is probably longer than engine cycle so schedule a restart at the next start time */
 
 
@@ -380,14 +386,12 @@ EXTERN unsigned short primaryTeethDroppedFromLackOfSync;
 
 /* Ignition stuff */
 
-// ignition experimentation stuff
-EXTERN unsigned char dwellQueueLength;				/* 0 = no dwell pending start, 1 = single event scheduled, 2 = one scheduled, and one in the queue, etc */
-EXTERN unsigned char ignitionQueueLength;			/* 0 = no spark event pending, 1 = single event scheduled, 2 = one scheduled, and one in the queue, etc */
-EXTERN unsigned char nextDwellChannel;				/* Which one to bang off next */
-EXTERN unsigned char nextIgnitionChannel;			/* Which one to bang off next */
-EXTERN unsigned short ignitionAdvances[IGNITION_CHANNELS * 2]; // Uses channel + offset to have two values at any time
-EXTERN unsigned short queuedDwellOffsets[IGNITION_CHANNELS]; // Uses next channel as index
-EXTERN unsigned short queuedIgnitionOffsets[IGNITION_CHANNELS]; // Uses next channel as index
+/* Coil switchings in time order with the soonest last, carried out by the RTI (init to zero required) */
+EXTERN unsigned char dwellQueueLength;				/* How many dwell starts are pending */
+EXTERN unsigned char ignitionQueueLength;			/* How many sparks are pending */
+EXTERN ignitionEvent dwellQueue[IGNITION_QUEUE_LENGTH];
+EXTERN ignitionEvent ignitionQueue[IGNITION_QUEUE_LENGTH];
+EXTERN unsigned short ignitionAdvances[IGNITION_CHANNELS]; /* Angle before each coils ignitionAngle to spark at, main loop only */
 
 
 /* Injection stuff */
@@ -397,8 +401,13 @@ EXTERN volatile unsigned short * volatile injectorMainTimeRegisters[INJECTION_CH
 EXTERN volatile unsigned char * volatile injectorMainControlRegisters[INJECTION_CHANNELS];
 
 /* Timer holding vars (init not required) */
-EXTERN unsigned short injectorMainStartTimesHolding[INJECTION_CHANNELS];
 EXTERN unsigned long injectorMainEndTimes[INJECTION_CHANNELS];
+EXTERN unsigned short injectorArmedPulseWidths[INJECTION_CHANNELS];	/* Width of the pulse each channel compare is set to open */
+
+/* Pulses waiting for each channel to close, free running counts masked into a ring (init to zero required) */
+EXTERN injectionEvent injectionQueues[INJECTION_CHANNELS][INJECTION_QUEUE_LENGTH];
+EXTERN unsigned char injectionQueueHeads[INJECTION_CHANNELS];		/* Incremented by the channel ISR as it takes a pulse */
+EXTERN unsigned char injectionQueueTails[INJECTION_CHANNELS];		/* Incremented by the scheduler as it adds a pulse */
 
 // TODO make these names consistent
 /* Code time to run variables (init not required) */
@@ -415,6 +424,23 @@ EXTERN unsigned short injectorMainPulseWidths1[INJECTION_CHANNELS];
 EXTERN unsigned short injectorStagedPulseWidths0[INJECTION_CHANNELS];
 EXTERN unsigned short injectorStagedPulseWidths1[INJECTION_CHANNELS];
 
+/* Channels held open by the main loop instead of being scheduled, same bits as TIE (init to zero required) */
+EXTERN unsigned char injectorsHeldOpen;
+
+/* Group fire channels that follow each leading channel and all followers together, same bits as TIE, from engineSettings.ports at init */
+EXTERN unsigned char injectorGroupFollowers[INJECTION_CHANNELS];
+EXTERN unsigned char injectorsFollowing;
+
+/* Rev limiter place in the cut patterns, one bit rotated through per event of each kind (init to one required) */
+EXTERN unsigned short fuelCutBit;
+EXTERN unsigned short sparkCutBit;
+
+/* Output events compiled per wheel event, swapped with the pulsewidths (init not required) */
+EXTERN outputEventList* outputEventsMath;
+EXTERN outputEventList* outputEventsRealtime;
+EXTERN outputEventList outputEvents0;
+EXTERN outputEventList outputEvents1;
+
 /* Channel latencies (init not required) */
 EXTERN unsigned short injectorCodeLatencies[INJECTION_CHANNELS];
 
@@ -60,10 +60,14 @@
 #define ARRAY_OF_16_TEMPS		{24315, 25315, 26315, 27315, 28315, 29315, 30315, 31315, 32315, 33315, 34315, 35315, 36315, 37315, 38315, 39315}
 /** An array of 16 percentages for temperature based enrichment. */
 #define ARRAY_OF_16_PERCENTS	{49152, 47513, 45875, 44237, 42598, 40960, 39321, 37683, 36045, 34406, 33587, 32768, 32768, 34406, 36045, 39321}
-/** Any array of 16 RPM values forAxis values for use as axes. TODO fill out values */
-#define ARRAY_OF_16_RPMS     	{    0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0}
+/** An array of 16 RPM values in RPM x 2 for use as axes, 0 to 7500 RPM. */
+#define ARRAY_OF_16_RPMS     	{    0,  1000,  2000,  3000,  4000,  5000,  6000,  7000,  8000,  9000, 10000, 11000, 12000, 13000, 14000, 15000}
+/** An array of 16 maximum dwell times in native ticks, 10ms cranking down to 6ms. */
+#define ARRAY_OF_16_MAX_DWELLS	{12500, 12500, 12500, 11250, 10000,  8750,  7500,  7500,  7500,  7500,  7500,  7500,  7500,  7500,  7500,  7500}
 /** An array of 6 percentage fuel trims, the value is 100%. */
 #define ARRAY_OF_6_FUEL_TRIMS	{32768, 32768, 32768, 32768, 32768, 32768}
+/** An array of 60 tooth angle corrections, all teeth where they should be. */
+#define ARRAY_OF_60_ZEROS   	{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0}
 
 
 /**
@@ -93,6 +97,7 @@ typedef struct {
 typedef struct {
 	unsigned char datalogStreamType;
 	unsigned short perCylinderFuelTrims[INJECTION_CHANNELS]; /* Trims for injection, from 0% to 200% of base */
+	signed char toothAngleCorrections[MAXIMUM_WHEEL_EVENTS]; /* Where each wheel event really is relative to event zero, in angle units, +-2.54 degrees */
 	unsigned char filler[SMALL_TABLES_2_FILLER_SIZE];
 } SmallTables2;
 
@@ -64,6 +64,7 @@ EXTERN void resetReceiveState(unsigned char) FPAGE_FE;
 EXTERN void finaliseAndSend(unsigned short) FPAGE_FE;
 
 EXTERN void populateBasicDatalog(void) FPAGE_FE;
+EXTERN void sendTriggerLog(void) FPAGE_FE;
 
 
 /* Global variables for TX (one set per interface) */
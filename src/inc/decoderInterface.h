@@ -42,14 +42,27 @@
 #define FILE_DECODER_INTERFACE_H_SEEN
 
 
+#ifdef EXTERN
+#warning "EXTERN already defined by another header, please sort it out!"
+#undef EXTERN /* If fail on warning is off, remove the definition such that we can redefine correctly. */
+#endif
+
+
+/* Only one decoder is linked into each image, so it owns the variables below */
+#ifdef DECODER_IMPLEMENTATION_C
+#define EXTERN
+#else
+#define EXTERN extern
+#endif
+
+
 /**
  * RPM Calculations:
  *
- * Either need a per decoder function that is called from the main loop OR...
- * RPM calculation is done in real time inside one of the RPM interrupts OR...
- * The choice of either, up to the decoder to decide how it is done, in this
- * case the function can either do nothing, or swap some pointers/var values
- * around or similar.
+ * Decoders do not divide. Each accepted tooth period is published with the
+ * PUBLISH_TOOTH_PERIOD() macro and the main loop turns the sum of the most
+ * recent periods into RPM with periodToRPM(). The decoder sets RPMDividend
+ * once at boot to account for how many of its periods make an engine cycle.
  *
  * MAP Sampling:
  *
@@ -58,6 +71,12 @@
  *
  * Scheduling:
  *
+ * Each decoder describes the angle of its wheel events once at boot. The main
+ * loop compiles every output angle into the nearest preceding wheel event and
+ * a tick delay at the current RPM, see generateOutputEvents(). The decoder ISR
+ * only hands its current wheel event and time stamp to scheduleOutputEvents()
+ * which arms the matching channels, so ISR time does not grow with angle math.
+ *
  * Fueling pins could be expected to fire once per cylinder event (1 - 12), or
  * once per engine cycle, or something in between, but what is a reasonable
  * max, and is it workable to allow some cases and not others?
@@ -86,17 +105,182 @@
  */
 
 
-// TODO @todo the below vars are just drafts so far, nothing is used, except the RPM stuff which I migrated here from the main header. More work to come.
-#define numberOfWheelEvents 1 // not teeth, teeth is misleading - could be leading or trailing edge or both
-unsigned char currentWheelEvent; // Current or last wheel event index.
-unsigned long wheelEventTimeStamps[numberOfWheelEvents]; // For logging wheel patterns as observed. LOTS of memory :-/ may not be possible except by sending lastStamp rapidly at low RPM
-unsigned short* RPM; // final output variable, probably move into inputVars struct?
-unsigned short* RPMRecord; // intermediate storage variable, do something with this?
-unsigned char ignitionEvents[6];
-unsigned char injectionEvents[12];
-unsigned char ADCSampleEvents[12]; // ???
-unsigned char stagedInjectionEvents; // ???
-unsigned char chickenCookerEvents; //  ???
+/* Wheel events are not teeth, they could be leading or trailing edges or both */
+EXTERN unsigned char currentWheelEvent;							/* Current or last wheel event index */
+EXTERN unsigned char numberOfWheelEvents;						/* Set at boot, zero if the decoder can't schedule yet */
+EXTERN unsigned short wheelEventCycleAngle;						/* Set at boot, the angle over which the wheel events repeat */
+EXTERN unsigned short outputCycleAngle;							/* Set at boot, the angle over which outputs repeat, twice the above numbers a second cycle of wheel events on from the first */
+EXTERN unsigned short wheelEventAngles[MAXIMUM_WHEEL_EVENTS];	/* Set at boot, angle of each event after event zero, ascending */
+
+// TODO @todo the below vars are just drafts so far, nothing is used.
+EXTERN unsigned char ADCSampleEvents[12]; // ???
+EXTERN unsigned char stagedInjectionEvents; // ???
+EXTERN unsigned char chickenCookerEvents; //  ???
+
+
+/* Raw tooth timing, written by the decoder ISRs and read atomically by the main loop */
+EXTERN unsigned long RPMDividend;									/* Set at boot, ticksPerCycleAtOneRPMx2 / periods per engine cycle, times the averaging tooth count */
+EXTERN unsigned long toothPeriods[MAXIMUM_RPM_AVERAGING_TEETH];	/* The most recent accepted tooth periods in ticks */
+EXTERN unsigned long toothPeriodSum;								/* Running sum of the above, zero until the engine has turned */
+EXTERN unsigned char toothPeriodIndex;								/* Where the next period will be written */
+EXTERN unsigned long latestToothPeriod;							/* The most recently published period */
+EXTERN unsigned long predictedToothPeriod;							/* The next period extrapolated from the last two, what outputs are scheduled with */
+EXTERN unsigned short toothPeriodAngle;								/* Set at boot, the angle that each published period covers */
+EXTERN unsigned long primaryNoiseWindow;							/* Set by the main loop, primary edges closer together than this are noise */
+EXTERN unsigned short toothStallTimeout;							/* Set by the main loop, RTI periods without a primary edge before the engine is stopped */
+
+
+/** Publish a tooth period
+ *
+ * Replace the oldest period in the averaging window with the latest one and
+ * keep the running sum up to date. An add, a subtract and a compare, so cheap
+ * enough for every tooth. The window length comes from the decoder settings.
+ *
+ * The first difference of the period is also carried forward one tooth so
+ * that outputs scheduled between teeth land where the crank will be under
+ * acceleration rather than where it would be if the last period held. If
+ * the period more than halved there is nothing sane to extrapolate and the
+ * last period is used as is, as it is when the prediction is turned off for
+ * wheels with more jitter than acceleration.
+ */
+#define PUBLISH_TOOTH_PERIOD(period)														\
+	do{																						\
+		toothPeriodSum += (period) - toothPeriods[toothPeriodIndex];						\
+		toothPeriods[toothPeriodIndex] = (period);											\
+		toothPeriodIndex++;																	\
+		if(toothPeriodIndex == fixedConfigs1.decoderSettings.RPMAveragingTeeth){			\
+			toothPeriodIndex = 0;															\
+		}																					\
+		if((fixedConfigs1.coreSettingsA & PREDICT_TOOTH_PERIOD) && (latestToothPeriod != 0) && (((period) << 1) > latestToothPeriod)){	\
+			predictedToothPeriod = ((period) << 1) - latestToothPeriod;						\
+		}else{																				\
+			predictedToothPeriod = (period);												\
+		}																					\
+		latestToothPeriod = (period);														\
+	}while(0)
+
+
+/* Trigger logger, every edge on either input goes in here whether or not anyone is listening */
+EXTERN triggerLogRecord triggerLog[TRIGGER_LOG_LENGTH];
+EXTERN unsigned short triggerLogHead;	/* Free running count of edges logged, the low bits index the buffer */
+
+
+/** Log an edge
+ *
+ * A handful of stores, masks and an increment, so cheap enough to leave
+ * on all the time. Nothing is ever blocked, when the serial side falls behind
+ * the oldest records are simply overwritten and the loss is counted there.
+ */
+#define LOG_TRIGGER_EDGE(stamp, input, portState)											\
+	do{																						\
+		triggerLog[triggerLogHead & (TRIGGER_LOG_LENGTH - 1)].timeStamp = (stamp);			\
+		triggerLog[triggerLogHead & (TRIGGER_LOG_LENGTH - 1)].edgeInfo = (input) | ((portState) & TRIGGER_LOG_PORT_MASK);	\
+		triggerLogHead++;																	\
+	}while(0)
+
+
+/** Reject primary noise
+ *
+ * Used first thing after the time stamp is built, before any decoding. A
+ * scheduling edge that arrives sooner after the last accepted one than the
+ * main loop says is possible is logged with the noise flag, counted and
+ * dropped without touching any decoder state. A zero window lets all through.
+ */
+#define REJECT_PRIMARY_NOISE(schedulingEdge, stamp, lastStamp, portState)					\
+	do{																						\
+		if((schedulingEdge) && (((stamp) - (lastStamp)) < primaryNoiseWindow)){				\
+			LOG_TRIGGER_EDGE((stamp), TRIGGER_LOG_PRIMARY | TRIGGER_LOG_NOISE, (portState));	\
+			Counters.primaryNoiseEdgesRejected++;											\
+			return;																			\
+		}																					\
+	}while(0)
+
+
+/** Feed the stall watchdog
+ *
+ * Used on every primary edge that gets past the noise check. Reloads the RTI
+ * count down, if it ever reaches zero the engine has stopped turning and the
+ * main loop is told so without waiting for the ADC reading timeout.
+ */
+#define FEED_STALL_WATCHDOG()																\
+	Clocks.toothStallClock = toothStallTimeout
+
+
+/* Cam phase, the secondary ISRs capture each cam edge against the last wheel event and camEdgesToPhases() does the rest */
+EXTERN unsigned long wheelEventTimeStamp;						/* Written by the primary ISR alongside currentWheelEvent */
+EXTERN camEdgeRecord camEdges[MAXIMUM_CAM_TEETH];				/* The latest capture for each cam tooth */
+EXTERN unsigned char camEdgesCaptured;							/* One bit per cam tooth, set by the ISR and cleared once the main loop has the capture */
+EXTERN unsigned char camToothIndex;								/* Which cam tooth the next edge is */
+EXTERN unsigned short camToothPhases[MAXIMUM_CAM_TEETH];		/* Filtered angle of each cam tooth after wheel event zero, less than wheelEventCycleAngle */
+
+
+/** Capture a cam edge
+ *
+ * Used on the configured secondary edge. A subtract and a few stores against
+ * what the primary ISR already keeps, the primary ISR itself only pays for
+ * storing the time stamp of each wheel event. Teeth are numbered in the order
+ * they arrive after crank sync is gained, so each physical tooth keeps its
+ * number for as long as sync holds.
+ */
+#define CAPTURE_CAM_EDGE(stamp)																\
+	do{																						\
+		if(coreStatusA & PRIMARY_SYNC){														\
+			camEdges[camToothIndex].ticksAfterWheelEvent = (stamp) - wheelEventTimeStamp;	\
+			camEdges[camToothIndex].toothPeriod = latestToothPeriod;						\
+			camEdges[camToothIndex].wheelEvent = currentWheelEvent;							\
+			camEdgesCaptured |= (1 << camToothIndex);										\
+			camToothIndex++;																\
+			if(camToothIndex >= fixedConfigs1.engineSettings.camTeeth){						\
+				camToothIndex = 0;															\
+			}																				\
+		}else{																				\
+			camToothIndex = 0;																\
+		}																					\
+	}while(0)
+
+
+/* Cranking, how far the engine turned before the decoder knew where it was */
+EXTERN unsigned short teethBeforeSync;							/* Scheduling edges seen without sync since the engine was last stopped */
+EXTERN unsigned short firstSyncTeeth;							/* The above including the tooth sync was first gained on, zero until then */
+EXTERN unsigned char firstSyncWheelEvent;						/* The wheel event sync was first gained on */
+
+
+/** Count a tooth before sync
+ *
+ * Used on each scheduling edge that arrives without sync, saturates rather
+ * than wrapping. Once the engine is synced this costs nothing.
+ */
+#define COUNT_TOOTH_BEFORE_SYNC()															\
+	do{																						\
+		if(teethBeforeSync < SHORTMAX){														\
+			teethBeforeSync++;																\
+		}																					\
+	}while(0)
+
+
+/** Record the first sync
+ *
+ * Used wherever sync is gained, with the wheel event that the last counted
+ * tooth was. Only the first sync after the engine starts turning is kept, the
+ * angle is worked out from it by firstSyncAngle() when someone asks.
+ */
+#define RECORD_FIRST_SYNC(event)															\
+	do{																						\
+		if(firstSyncTeeth == 0){															\
+			firstSyncTeeth = teethBeforeSync;												\
+			firstSyncWheelEvent = (event);													\
+		}																					\
+	}while(0)
+
+
+/** Per decoder init routine
+ *
+ * Called once at boot after the configuration has been checked. Decoders that
+ * can precompute anything from the engine settings should do it here rather
+ * than in their ISRs. Every decoder must provide one, and set outputCycleAngle
+ * in it, as the output angles are checked against that straight after.
+ */
+EXTERN void decoderInitPreliminary(void) FPAGE_FE;
 
 
 // Init routine:
@@ -114,6 +298,9 @@ unsigned char chickenCookerEvents; //  ???
 // stuff to do with timing and sync etc. ie, figuring out upon which
 
 
+#undef EXTERN
+
+
 
 #else
 	/* let us know if we are being untidy with headers */
@@ -49,6 +49,11 @@
 
 
 EXTERN void generateDerivedVars(void) FPAGE_FE;
+/* In the tunable tables page along with the tables they read */
+EXTERN unsigned short lookupInjectorDeadTime(unsigned short BRV) TUNETABLESF;
+EXTERN unsigned short lookupMaximumDwell(unsigned short RPM) TUNETABLESF;
+EXTERN unsigned short lookupDesiredDwell(unsigned short BRV) TUNETABLESF;
+EXTERN void forgetInjectorDeadTimeSegment(void) TUNETABLESF;
 
 
 #undef EXTERN
@@ -70,6 +70,20 @@
 #define VE_TABLE_MAIN_RPM_LENGTH_TOO_LONG	0x2001
 #define VE_TABLE_MAIN_MAIN_LENGTH_TOO_LONG	0x2002
 #define BRV_MAX_TOO_LARGE					0x2003
+#define WHEEL_TOO_MANY_TEETH				0x2004
+#define WHEEL_TOO_MANY_GAPS					0x2005
+#define WHEEL_GAP_POSITION_INVALID			0x2006
+#define RPM_AVERAGING_TEETH_INVALID			0x2007
+#define ENGINE_SETTINGS_ZERO_COUNT			0x2008
+#define INJECTION_ANGLE_INVALID				0x2009
+#define DECODER_TYPE_INVALID				0x200A
+#define CAM_TEETH_INVALID					0x200B
+#define OVER_DUTY_SPLITS_INVALID			0x200C
+#define INJECTION_GROUPS_INVALID			0x200D
+#define COIL_COUNT_INVALID					0x200E
+#define IGNITION_ANGLE_INVALID				0x200F
+#define STALL_TIMEOUT_INVALID				0x2010
+#define CAM_SYNC_TOOTH_INVALID				0x2011
 
 
 /* Flash burning error codes */
@@ -49,6 +49,7 @@
 
 
 EXTERN void calculateFuelAndIgnition(void) FPAGE_FE;
+EXTERN void calculateDwell(void) FPAGE_FE;
 
 
 /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&& Always show your working! &&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
@@ -87,6 +87,9 @@ EXTERN const unsigned char firmwareVersion[31];
 EXTERN const unsigned short dwellStartMasks[IGNITION_CHANNELS];
 EXTERN const unsigned short ignitionMasks[IGNITION_CHANNELS];
 
+/* Rev limiter */
+EXTERN const unsigned short revLimitCutPatterns[REV_LIMIT_CUT_STEPS + 1];
+
 /* Injection */
 EXTERN const unsigned char injectorMainOnMasks[INJECTION_CHANNELS];
 EXTERN const unsigned char injectorMainOffMasks[INJECTION_CHANNELS];
@@ -178,6 +181,9 @@ EXTERN const unsigned short ignitionMaximumDwell;
 /* Ignition minimum dwell in timer units */
 EXTERN const unsigned short ignitionMinimumDwell;
 
+/* Ignition minimum time from a spark to the next dwell on the same coil in timer units */
+EXTERN const unsigned short ignitionMinimumOffTime;
+
 /* Ignition maximum delay post schedule tooth in timer units */
 EXTERN const unsigned short ignitionMaximumDelayToDwellStartAfterTooth;
 
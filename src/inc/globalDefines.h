@@ -236,6 +236,10 @@
 
 #define ticksPerCycleAtOneRPMx2	300000000	/* twice how many 0.8us ticks there are in between engine cycles at 1 RPM */
 #define ticksPerCycleAtOneRPM	150000000	/* how many 0.8us ticks there are in between engine cycles at 1 RPM */
+#define ANGLE_FACTOR			50			/* Angles are stored in 50ths of a degree... */
+#define ENGINE_CYCLE_ANGLE		36000		/* ...such that a full 720 degree cycle fits in a short */
+#define CAM_PHASE_LAG			4			/* Cam phases move this fraction of the way to each new measurement... */
+#define CAM_PHASE_STEP_LIMIT	500			/* ...unless it is more than 10 degrees away, when it is taken as is */
 #define tachoTickFactor4at50	6			/* Provides for a 4 cylinder down to 50 RPM  */
 /*efine tachoEdgesPerCycle4at50	8			/  8 events per cycle for a typical 4 cylinder tacho, 4 on, 4 off */
 #define tachoTotalFactor4at50	48			/* http://www.google.com/search?hl=en&safe=off&q=((150000000+%2F+6)+%2F++8+)+%2F+50&btnG=Search */
@@ -260,8 +264,29 @@
 #define IGNITION_CHANNELS 12	/* How many ignition channels the code should support */
 #define INJECTION_CHANNELS 6	/* How many injection channels the code should support */
 
+#define MAXIMUM_PRIMARY_TEETH 60	/* How many crank teeth, including missing ones, a wheel description may contain */
+#define MAXIMUM_WHEEL_GAPS 4		/* How many groups of missing teeth a wheel description may contain */
+#define MAXIMUM_RPM_AVERAGING_TEETH 8	/* How many tooth periods RPM may be averaged over */
+#define TRIGGER_LOG_LENGTH 32			/* How many edges the trigger logger holds, MUST be a power of two */
+#define TRIGGER_LOG_RECORDS_PER_PACKET 16	/* How many edges are sent in each trigger log packet */
+#define MAXIMUM_WHEEL_EVENTS MAXIMUM_PRIMARY_TEETH	/* How many wheel events a decoder may describe to the scheduler */
+#define MAXIMUM_INJECTION_SPLITS 2					/* How many shorter pulses an over duty injection may be split into */
+#define MAXIMUM_OUTPUT_EVENTS ((INJECTION_CHANNELS * MAXIMUM_INJECTION_SPLITS) + (IGNITION_CHANNELS * 2))	/* How many output events may be scheduled per cycle */
+#define OUTPUT_EVENT_INDEX_LENGTH ((MAXIMUM_WHEEL_EVENTS * 2) + 1)	/* One entry per wheel event of two wheel event cycles, and one for the end */
+#define IGNITION_EVENT 0x80							/* Output event channel flag for a coil rather than an injector */
+#define SPARK_ANCHOR_EVENT 0x40						/* Output event channel flag for a coil event that only retimes its spark */
+#define INJECTION_QUEUE_LENGTH 4					/* How many pulses may wait behind the current one on each injection channel, must be a power of two */
+#define INJECTION_QUEUE_MASK (INJECTION_QUEUE_LENGTH - 1)	/* Turns the free running queue counts into a slot */
+#define STAGED_EVENT_SLOTS 8						/* How many scheduled staged injector switchings may be pending across all channels */
+#define IGNITION_QUEUE_LENGTH IGNITION_CHANNELS		/* How many dwell starts and how many sparks may be pending across all coils */
+#define RTI_PERIOD_TICKS 160						/* The 128us RTI period in 0.8us timer ticks */
+#define REV_LIMIT_CUT_STEPS 16						/* Events per rev limiter cut pattern, one per bit */
+#define REV_LIMIT_HYSTERESIS 200					/* RPM x 2 under revLimitRPM before the rev limiter lets go */
+#define NO_WHEEL_EVENT 0xFF							/* Wheel event number that never matches */
+#define MAXIMUM_CAM_TEETH 8							/* How many cam teeth per cycle have their phase measured, one bit each in camEdgesCaptured */
+
 #define SMALL_TABLES_1_FILLER_SIZE  576 // Left over space in small tables 2 blocks
-#define SMALL_TABLES_2_FILLER_SIZE 1011 // Left over space in small tables 2 blocks
+#define SMALL_TABLES_2_FILLER_SIZE  951 // Left over space in small tables 2 blocks
 #define SMALL_TABLES_3_FILLER_SIZE 1024 // Left over space in small tables 2 blocks
 #define SMALL_TABLES_4_FILLER_SIZE 1024 // Left over space in small tables 2 blocks
 
@@ -63,6 +63,7 @@ void initLookupAddresses(void) LOOKUPF;
 void initFuelAddresses(void) FUELTABLESF;
 void initTimingAddresses(void) TIMETABLESF;
 void initTunableAddresses(void) TUNETABLESF;
+void initToothAngleCorrections(void) TUNETABLESF;
 void initPagedRAMFuel(void) FUELTABLESF;
 void initPagedRAMTime(void) TIMETABLESF;
 void initPagedRAMTune(void) TUNETABLESF;
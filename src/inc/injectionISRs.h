@@ -69,10 +69,77 @@
 #define STAGED5OFF NBIT4
 #define STAGED6OFF NBIT5
 
+/* Main injector channel registers and masks, resolved at compile time in each ISR */
+/* These follow the vector table, the runtime arrays for the scheduler must match */
+
+/* Compare register for each channel */
+#define INJECTOR1TIME TC1
+#define INJECTOR2TIME TC2
+#define INJECTOR3TIME TC3
+#define INJECTOR4TIME TC4
+#define INJECTOR5TIME TC6
+#define INJECTOR6TIME TC7
+
+/* Output action register for each channel */
+#define INJECTOR1CONTROL TCTL2
+#define INJECTOR2CONTROL TCTL2
+#define INJECTOR3CONTROL TCTL2
+#define INJECTOR4CONTROL TCTL1
+#define INJECTOR5CONTROL TCTL1
+#define INJECTOR6CONTROL TCTL1
+
+/* Masks for the flag, interrupt enable and port T bits of each channel */
+#define INJECTOR1ON BIT1
+#define INJECTOR2ON BIT2
+#define INJECTOR3ON BIT3
+#define INJECTOR4ON BIT4
+#define INJECTOR5ON BIT6
+#define INJECTOR6ON BIT7
+
+/* Masks for clearing the interrupt enable bit of each channel */
+#define INJECTOR1OFF NBIT1
+#define INJECTOR2OFF NBIT2
+#define INJECTOR3OFF NBIT3
+#define INJECTOR4OFF NBIT4
+#define INJECTOR5OFF NBIT6
+#define INJECTOR6OFF NBIT7
+
+/* Masks for setting the output action of each channel to go high */
+#define INJECTOR1GOHIGH BIT2
+#define INJECTOR2GOHIGH BIT4
+#define INJECTOR3GOHIGH BIT6
+#define INJECTOR4GOHIGH BIT0
+#define INJECTOR5GOHIGH BIT4
+#define INJECTOR6GOHIGH BIT6
+
+/* Masks for setting the output action of each channel to go low */
+#define INJECTOR1GOLOW NBIT2
+#define INJECTOR2GOLOW NBIT4
+#define INJECTOR3GOLOW NBIT6
+#define INJECTOR4GOLOW NBIT0
+#define INJECTOR5GOLOW NBIT4
+#define INJECTOR6GOLOW NBIT6
+
+/* Masks for disconnecting each channel from its pin */
+#define INJECTOR1DISABLE 0xF3
+#define INJECTOR2DISABLE 0xCF
+#define INJECTOR3DISABLE 0x3F
+#define INJECTOR4DISABLE 0xFC
+#define INJECTOR5DISABLE 0xCF
+#define INJECTOR6DISABLE 0x3F
+
 /* Internal use to decide if staged is actually required or not based on pulsewidth etc */
 unsigned char stagedRequired;
 
 
+/* Called from the injector ISRs and the RTI, so must stay in unpaged flash */
+EXTERN void queueStagedEvent(unsigned long time, unsigned char channelMask, unsigned char switchOn);
+EXTERN void cancelStagedEvents(unsigned char channelMask);
+EXTERN void serviceStagedEvents(void);
+EXTERN void setInjectorGroup(unsigned char followers, unsigned short time, unsigned char switchOn);
+EXTERN void disableInjectorGroup(unsigned char followers);
+
+
 #undef EXTERN
 
 
@@ -30,7 +30,8 @@
  *
  * This code is identical between all 6 channels, and thus we only want one
  * copy of it. The X in each macro will be replaced with the number that is
- * appropriate for the channel it is being used for at the time.
+ * appropriate for the channel it is being used for at the time. The registers
+ * and masks are macros too, so each copy works on its own hardware directly.
  *
  * Each channel performs the following actions
  *
@@ -41,14 +42,15 @@
  *   - 4.1	Copy the channels pulse width to a local variable
  *   - 4.2	Determine the minimum pulse width based on code run time const and latency
  *   - 4.3	Clamp used pulsewidth inside min and max
- *   - 4.4	If used pulse width is larger than the current period of the engines cycle flag as always on
+ *   - 4.4	(Pulses too long for the engine period are held open or split by generateOutputEvents() instead)
  *   - 4.5	Set the action to turn off
  *   - 4.6	Increment the time by pulse width
- *   - 4.7	If staging required, either, switch them on and sched to turn off, or sched to turn on
+ *   - 4.7	Set any group fire followers to switch off with it
+ *   - 4.8	If staging required and there is room for all of it, switch on now or schedule the start, and schedule the end if it isn't fixed
  * - 5	Else it has just turned off
- *   - 5.1	If staged channel is still on, turn it off
- *   - 5.2	If(self schedule flagged) schedule the next start
- *   - 5.3	Else disable itself
+ *   - 5.1	If staged end is fixed, cancel any pending start and turn it off
+ *   - 5.2	If a pulse is queued, take it and schedule its start and that of any group fire followers
+ *   - 5.3	Else disable itself and any group fire followers
  * - 6	Calculate and record code run time
  * - 7	Return
  *
@@ -58,22 +60,22 @@
 
 void InjectorXISR(){
 	/* Clear the interrupt flag for this channel */
-	TFLG = injectorMainOnMasks[INJECTOR_CHANNEL_NUMBER];
+	TFLG = INJECTORXON;
 
 	/* Record the current time as start time */
 	unsigned short TCNTStart = TCNT;
 
 	/* Record the edge time stamp from the IC register */
-	unsigned short edgeTimeStamp = *injectorMainTimeRegisters[INJECTOR_CHANNEL_NUMBER];
+	unsigned short edgeTimeStamp = INJECTORXTIME;
 
 	/* Calculate and store the latency based on compare time and start time */
 	injectorCodeLatencies[INJECTOR_CHANNEL_NUMBER] = TCNTStart - edgeTimeStamp;
 
 	/* If rising edge triggered this */
-	if(PTIT & injectorMainOnMasks[INJECTOR_CHANNEL_NUMBER]){ // Stuff for switch on time
+	if(PTIT & INJECTORXON){ // Stuff for switch on time
 
 		/* Find out what max and min for pulse width are */
-		unsigned short localPulseWidth = injectorMainPulseWidthsRealtime[INJECTOR_CHANNEL_NUMBER];
+		unsigned short localPulseWidth = injectorArmedPulseWidths[INJECTOR_CHANNEL_NUMBER];
 		unsigned short localMinimumPulseWidth = injectorSwitchOnCodeTime + injectorCodeLatencies[INJECTOR_CHANNEL_NUMBER];
 
 		/** @todo TODO *maybe* instead of checking min and increasing pulse, just force it straight off if diff between start and now+const is greater than desired pulsewidth */
@@ -85,55 +87,91 @@ void InjectorXISR(){
 
 		LongTime timeStamp;
 
-		/* Install the low word */
-		timeStamp.timeShorts[1] = edgeTimeStamp;
-		/* Find out what our timer value means and put it in the high word */
-		if(TFLGOF && !(edgeTimeStamp & 0x8000)){ /* see 10.3.5 paragraph 4 of 68hc11 ref manual for details */
-			timeStamp.timeShorts[0] = timerExtensionClock + 1;
-		}else{
-			timeStamp.timeShorts[0] = timerExtensionClock;
-		}
+		EXTEND_TIME_STAMP(timeStamp, edgeTimeStamp);
 
 		// store the end time for use in the scheduler
 		injectorMainEndTimes[INJECTOR_CHANNEL_NUMBER] = timeStamp.timeLong + localPulseWidth;
 
 		/* Set the action for compare to switch off FIRST or it might inadvertently PWM the injector during opening... */
-		*injectorMainControlRegisters[INJECTOR_CHANNEL_NUMBER] &= injectorMainGoLowMasks[INJECTOR_CHANNEL_NUMBER];
+		INJECTORXCONTROL &= INJECTORXGOLOW;
 
 		/* Set the time to turn off again */
-		*injectorMainTimeRegisters[INJECTOR_CHANNEL_NUMBER] += localPulseWidth;
+		INJECTORXTIME += localPulseWidth;
+
+		/* Group fire followers switched on with us by their own compares, now they switch off with us too */
+		if(injectorGroupFollowers[INJECTOR_CHANNEL_NUMBER]){
+			setInjectorGroup(injectorGroupFollowers[INJECTOR_CHANNEL_NUMBER], INJECTORXTIME, FALSE);
+		}
 
 		/* This is the point we actually want the time to, but because the code is so simple, it can't help but be a nice short time */
 
 		/* If staged injection is required, switch on or schedule corresponding staged injector and remember that we did. */
 		if(coreStatusA & STAGED_REQUIRED){
-			if(fixedConfigs1.coreSettingsA & STAGED_START){
-				/* Switch that channel on NOW */
-				STAGEDPORT |= STAGEDXON;
-				stagedOn |= STAGEDXON;
+			unsigned short stagedPulseWidth = injectorStagedPulseWidthsRealtime[INJECTOR_CHANNEL_NUMBER];
+			unsigned char scheduledStart = !(fixedConfigs1.coreSettingsA & STAGED_START) && (stagedPulseWidth < localPulseWidth);
+			unsigned char scheduledEnd = !(fixedConfigs1.coreSettingsA & STAGED_END);
+
+			/* Room for both or neither, as a start without its end would hold the staged injector open */
+			if((STAGED_EVENT_SLOTS - stagedEventsPending) < (scheduledStart + scheduledEnd)){
+				Counters.stagedEventsDropped++;
 			}else{
-				/* Schedule the start at a later time */
-				/// @todo TODO PIT scheduling of staged start
+				unsigned short stagedDelay = 0;
+				if(scheduledStart){
+					/* Scheduled start, such that the staged pulse finishes with the main one */
+					stagedDelay = localPulseWidth - stagedPulseWidth;
+					queueStagedEvent(timeStamp.timeLong + stagedDelay, STAGEDXON, TRUE);
+				}else{
+					/* Switch that channel on NOW */
+					STAGEDPORT |= STAGEDXON;
+					stagedOn |= STAGEDXON;
+				}
+
+				if(scheduledEnd){
+					/* Scheduled end, hold it for its own pulse width rather than the main one */
+					queueStagedEvent(timeStamp.timeLong + stagedDelay + stagedPulseWidth, STAGEDXON, FALSE);
+				}
 			}
 		}
 		/* Calculate and store code run time */
 		injectorCodeOpenRuntimes[INJECTOR_CHANNEL_NUMBER] = TCNT - TCNTStart;
 	}else{ // Stuff for switch off time
-		/* If we switched the staged injector on and it's still on, turn it off now. */
-		if(stagedOn & STAGEDXON){
-			STAGEDPORT &= STAGEDXOFF;
-			stagedOn &= STAGEDXOFF;
+		/* With a fixed end, a start that hasn't happened yet never will, and if we switched the staged injector on and it's still on, turn it off now. */
+		if(fixedConfigs1.coreSettingsA & STAGED_END){
+			cancelStagedEvents(STAGEDXON);
+			if(stagedOn & STAGEDXON){
+				STAGEDPORT &= STAGEDXOFF;
+				stagedOn &= STAGEDXOFF;
+			}
 		}
 
-		/* Set the action for compare to switch on and the time to next start time, clear the self timer flag */
-		if(selfSetTimer & injectorMainOnMasks[INJECTOR_CHANNEL_NUMBER]){
-			*injectorMainTimeRegisters[INJECTOR_CHANNEL_NUMBER] = injectorMainStartTimesHolding[INJECTOR_CHANNEL_NUMBER];
-			*injectorMainControlRegisters[INJECTOR_CHANNEL_NUMBER] |= injectorMainGoHighMasks[INJECTOR_CHANNEL_NUMBER];
-			selfSetTimer &= injectorMainOffMasks[INJECTOR_CHANNEL_NUMBER];
+		/* Set the action for compare to switch on and the time to the next queued start, if there is one */
+		if(injectionQueueHeads[INJECTOR_CHANNEL_NUMBER] != injectionQueueTails[INJECTOR_CHANNEL_NUMBER]){
+			injectionEvent* next = &injectionQueues[INJECTOR_CHANNEL_NUMBER][injectionQueueHeads[INJECTOR_CHANNEL_NUMBER] & INJECTION_QUEUE_MASK];
+			injectionQueueHeads[INJECTOR_CHANNEL_NUMBER]++;
+
+			/* A start already behind us would wait a whole turn of the timer, open as soon as we can instead */
+			unsigned short timerCount = TCNT;
+			LongTime earliestStart;
+			EXTEND_TIME_STAMP(earliestStart, timerCount);
+			earliestStart.timeLong += injectorSwitchOnCodeTime;
+			unsigned short startTime = (unsigned short)next->startTime;
+			if((next->startTime - earliestStart.timeLong) > LONGHALF){
+				startTime = (unsigned short)earliestStart.timeLong;
+			}
+
+			injectorArmedPulseWidths[INJECTOR_CHANNEL_NUMBER] = next->pulseWidth;
+			INJECTORXTIME = startTime;
+			INJECTORXCONTROL |= INJECTORXGOHIGH;
+			if(injectorGroupFollowers[INJECTOR_CHANNEL_NUMBER]){
+				setInjectorGroup(injectorGroupFollowers[INJECTOR_CHANNEL_NUMBER], startTime, TRUE);
+			}
 		}else{
 			// Disable interrupts and actions incase the period from this end to the next start is long (saves cpu)
-			TIE &= injectorMainOffMasks[INJECTOR_CHANNEL_NUMBER];
-			*injectorMainControlRegisters[INJECTOR_CHANNEL_NUMBER] &= injectorMainDisableMasks[INJECTOR_CHANNEL_NUMBER];
+			TIE &= INJECTORXOFF;
+			INJECTORXCONTROL &= INJECTORXDISABLE;
+			if(injectorGroupFollowers[INJECTOR_CHANNEL_NUMBER]){
+				disableInjectorGroup(injectorGroupFollowers[INJECTOR_CHANNEL_NUMBER]);
+			}
 		}
 		/* Calculate and store code run time */
 		injectorCodeCloseRuntimes[INJECTOR_CHANNEL_NUMBER] = TCNT - TCNTStart;
@@ -49,6 +49,8 @@
 /* http://gcc.gnu.org/onlinedocs/gcc-4.0.0/gcc/Function-Attributes.html	*/
 /* http://gcc.gnu.org/onlinedocs/gcc-4.0.0/gcc/Variable-Attributes.html	*/
 
+/* The replay harness builds the decoders on the host and supplies its own INT and ATOMIC_ versions */
+#ifndef INT
 /* Interrupt attribute shortcut */
 #define INT __attribute__((interrupt))
 
@@ -59,6 +61,39 @@
 /* http://hubbard.engr.scu.edu/embedded/avr/doc/avr-libc/avr-libc-user-manual/group__avr__interrupts.html */
 #define ATOMIC_START() __asm__ __volatile__ ("sei")	/* set global interrupt mask */
 #define ATOMIC_END() __asm__ __volatile__ ("cli")	/* clear global interrupt mask */
+#endif
+
+/** Extend a 16 bit timer capture to a full 32 bit time stamp
+ *
+ * The low word is the capture itself and the high word is the count of timer
+ * overflows at the moment of capture. timerExtensionClock only counts the
+ * overflows TimerOverflow has already handled, so one may still be pending.
+ * Every timer channel outranks the overflow vector, so an overflow between the
+ * capture and entry to the ISR that services it is always still pending here.
+ * It is also free to become pending while this ISR runs, right up until TFLGOF
+ * is read below. A pending overflow belongs to this capture only if the
+ * capture is in the lower half of the timer range, ie, it was taken after the
+ * wrap. An upper half capture was taken before the wrap and a lower half one
+ * can not be more than half a turn of the timer old while the overflow that
+ * preceded it is still pending. That holds while ISR latency and overflow
+ * service delay both stay under 0x8000 ticks. See 10.3.5 paragraph 4 of the
+ * 68hc11 reference manual for details.
+ *
+ * The capture bit is tested first so that captures in the upper half of the
+ * range, which can never need the correction, skip the register read.
+ *
+ * @param timeStamp the LongTime to fill in
+ * @param capture a local copy of the capture register, evaluated twice
+ */
+#define EXTEND_TIME_STAMP(timeStamp, capture)                        \
+	do{                                                              \
+		(timeStamp).timeShorts[1] = (capture);                       \
+		if(!((capture) & 0x8000) && (TFLGOF & 0x80)){                \
+			(timeStamp).timeShorts[0] = timerExtensionClock + 1;     \
+		}else{                                                       \
+			(timeStamp).timeShorts[0] = timerExtensionClock;         \
+		}                                                            \
+	}while(0)
 
 /* Interrupt vector memory management */
 #define VECTORS __attribute__ ((section (".vectors")))
@@ -85,11 +120,6 @@ void SecondaryRPMISR(void) INT TEXT1;		/* IC timer for secondary engine position
 void TimerOverflow(void) INT TEXT1;		/* IC/OC timer overflow handling */
 void ModDownCtrISR(void) INT TEXT1;		/* Modulus Down Counter */
 
-void IgnitionDwellISR(void) INT TEXT1;	/* PIT timer 0 for dwell start */
-void IgnitionFireISR(void) INT TEXT1;		/* PIT timer 1 for coil firing */
-void StagedOnISR(void) INT TEXT1;			/* PIT timer 2 for switching staged injectors on */
-void StagedOffISR(void) INT TEXT1;		/* PIT timer 3 for switching staged injectors off */
-
 void PortPISR(void) INT TEXT1;			/* Port P interrupt service routine */
 void PortHISR(void) INT TEXT1;			/* Port P interrupt service routine */
 void PortJISR(void) INT TEXT1;			/* Port P interrupt service routine */
@@ -44,6 +44,7 @@
 #include "coreVarsGenerator.h"
 #include "derivedVarsGenerator.h"
 #include "fuelAndIgnitionCalcs.h"
+#include "outputScheduler.h"
 #include "decoderInterface.h"
 
 
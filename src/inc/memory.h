@@ -60,6 +60,12 @@
 /*define SERMON		__attribute__ ((section (".sermon")))	      2k unpaged block, occupied by AN2548 serial monitor. 	*/
 
 
+/* The target is big endian, host builds such as the replay harness set this to keep unions laid out the same */
+#ifndef BIG_ENDIAN_LAYOUT
+#define BIG_ENDIAN_LAYOUT
+#endif
+
+
 /* far shortcut for data */
 #define DFAR(label) __attribute__ ((section (label)))
 /* far shortcut for functions */
@@ -89,6 +89,8 @@
 #define requestConfigurableDatalog  0x0192
 #define responseConfigurableDatalog 0x0193 /* Defined because it can be used both synchronously and asynchronously */
 #define setAsyncDatalogType         0x0194
+//efine requestTriggerLog           0x0196 /* This is reserved */
+#define asyncTriggerLogPacket       0x0197 /* NOTE : Unrequested, streamed while asyncDatalogTrigger is selected */
 
 /* Special function */
 #define forwardPacketOverCAN        0x01F4
@@ -341,7 +341,7 @@ typedef struct {
 
 
 #define COUNTER_SIZE sizeof(Counter)
-#define COUNTER_LENGTH 21			/* How many counters */
+#define COUNTER_LENGTH 32			/* How many counters */
 #define COUNTER_UNIT 2				/* How large each element is in bytes (short = 2 bytes) */
 /* Use this block to manage the execution count of various functions loops and ISRs etc */
 typedef struct {
@@ -378,11 +378,22 @@ typedef struct {
 	unsigned short commsPacketsUnderMinLength;			/* Incremented when a packet is found that is too short					*/
 	unsigned short commsDebugMessagesNotSent;			/* Incremented when a debug message can't be sent due to the TX buffer  */
 	unsigned short commsErrorMessagesNotSent;			/* Incremented when an error message can't be sent due to the TX buffer */
+
+	/* Decoder and scheduler counters, new ones go on the end so that older log offsets still hold */
+	unsigned short triggerLogRecordsLost;				/* Incremented for each trigger log record overwritten before sending	*/
+	unsigned short primaryNoiseEdgesRejected;			/* Incremented for each primary edge inside the noise window			*/
+	unsigned short toothStalls;							/* Incremented each time the stall watchdog stops the engine			*/
+	unsigned short injectionEventsDropped;				/* Incremented for each pulse scheduled onto a full injection queue		*/
+	unsigned short stagedEventsDropped;					/* Incremented for each staged pulse without room for all of its switchings	*/
+	unsigned short ignitionEventsDropped;				/* Incremented for each spark scheduled onto a full ignition queue		*/
+	unsigned short revLimiterEngagements;				/* Incremented each time RPM goes over revLimitRPM and events are cut	*/
+	unsigned short revLimiterFuelCuts;					/* Incremented for each injection event dropped by the rev limiter		*/
+	unsigned short revLimiterSparkCuts;					/* Incremented for each ignition event dropped by the rev limiter		*/
 } Counter;
 
 
 #define CLOCK_SIZE sizeof(Clock)
-#define CLOCK_LENGTH 9				/* How many clocks */
+#define CLOCK_LENGTH 10				/* How many clocks */
 #define CLOCK_UNIT 2				/* How large each element is in bytes (short = 2 bytes) */
 /* Use this block to manage the various clocks kept */
 typedef struct {
@@ -398,9 +409,80 @@ typedef struct {
 	unsigned short secondsToMinutes;					/* Roll-over variable for counting minutes				*/
 
 	unsigned short timeoutADCreadingClock;				/* Timeout clock/counter for synced ADC readings		*/
+	unsigned short toothStallClock;						/* Counts down in RTIs, reloaded by each primary tooth	*/
 } Clock;
 
 
+#define OUTPUT_EVENT_SIZE sizeof(outputEvent)
+/* One output to be armed by the decoder when a particular wheel event is seen */
+typedef struct {
+	unsigned char wheelEvent;							/* Which wheel event to schedule from					*/
+	unsigned char channel;								/* Which output channel to arm							*/
+	unsigned short toothFraction;						/* Delay from the wheel event in 256ths of a tooth period	*/
+	unsigned short pulseWidth;							/* How long to open the channel for, less when split, unused for coils	*/
+} outputEvent;
+
+
+#define OUTPUT_EVENT_LIST_SIZE sizeof(outputEventList)
+/* All outputs for one engine cycle, built by the main loop and walked by the decoder */
+typedef struct {
+	unsigned char count;								/* How many of the events below are in use				*/
+	unsigned char extraSparks;							/* How many more times each coil dwells and fires after its spark	*/
+	unsigned short extraSparkDwell;						/* Dwell for each of those in ticks						*/
+	unsigned short fuelCutPattern;						/* Rev limiter, injection events with their bit set are dropped	*/
+	unsigned short sparkCutPattern;						/* Rev limiter, ignition events with their bit set are dropped	*/
+	unsigned char firstEvents[OUTPUT_EVENT_INDEX_LENGTH];	/* Where each wheel event's events start, they run to where the next one's do	*/
+	outputEvent events[MAXIMUM_OUTPUT_EVENTS];			/* Ordered by wheel event									*/
+} outputEventList;
+
+
+#define INJECTION_EVENT_SIZE sizeof(injectionEvent)
+/* One pulse waiting for an injection channel to finish the one before it */
+typedef struct {
+	unsigned long startTime;							/* Extended time to open at, within a compare's reach of when it was queued	*/
+	unsigned short pulseWidth;							/* How long to hold it open, fixed when it was scheduled	*/
+} injectionEvent;
+
+
+#define STAGED_EVENT_SIZE sizeof(stagedEvent)
+/* One staged injector switching, carried out by the RTI once its time has come */
+typedef struct {
+	unsigned long time;									/* Extended time to switch at							*/
+	unsigned char channelMask;							/* Which staged output, zero marks a free slot			*/
+	unsigned char switchOn;								/* Whether to switch it on or off						*/
+} stagedEvent;
+
+
+#define IGNITION_EVENT_SIZE sizeof(ignitionEvent)
+/* One coil dwell start or spark, carried out by the RTI once its time has come */
+typedef struct {
+	unsigned long time;									/* Extended time to switch at							*/
+	unsigned char channel;								/* Which coil to switch									*/
+	unsigned char extraSparks;							/* How many more sparks follow this one, unused for dwell	*/
+} ignitionEvent;
+
+
+#define TRIGGER_LOG_RECORD_SIZE sizeof(triggerLogRecord)
+/* One edge as seen by either RPM input, kept for the trigger logger */
+typedef struct {
+	unsigned long timeStamp;							/* Extended 32 bit time stamp of the edge				*/
+	unsigned char edgeInfo;								/* Which input and the port state after the edge		*/
+} triggerLogRecord;
+
+/* One cam edge against the crank, captured by the secondary ISR and turned into an angle by the main loop */
+typedef struct {
+	unsigned long ticksAfterWheelEvent;					/* Time from the wheel event before the edge to the edge	*/
+	unsigned long toothPeriod;							/* Latest tooth period when the edge arrived			*/
+	unsigned char wheelEvent;							/* Which wheel event the edge followed					*/
+} camEdgeRecord;
+
+/* Masks for edgeInfo, the low six bits are port T as sampled in the ISR, giving the level of both inputs */
+#define TRIGGER_LOG_PRIMARY		ZEROS					/* Input ID for the primary input						*/
+#define TRIGGER_LOG_SECONDARY	BIT7					/* Input ID for the secondary input						*/
+#define TRIGGER_LOG_NOISE		BIT6					/* Edge was rejected by the noise window				*/
+#define TRIGGER_LOG_PORT_MASK	0x3F					/* Port T bits kept alongside the input ID and flags	*/
+
+
 #else
 	/* let us know if we are being untidy with headers */
 	#warning "Header file STRUCTS_H seen before, sort it out!"
@@ -50,6 +50,11 @@
 EXTERN unsigned short safeAdd(unsigned short, unsigned short);
 EXTERN unsigned short safeTrim(unsigned short, signed short);
 EXTERN unsigned short safeScale(unsigned short, unsigned short);
+EXTERN unsigned short periodToRPM(unsigned long, unsigned long) FPAGE_F8;
+EXTERN unsigned long periodToNoiseWindow(unsigned long) FPAGE_F8;
+EXTERN unsigned short periodToStallTimeout(unsigned long) FPAGE_F8;
+EXTERN void camEdgesToPhases(void) FPAGE_F8;
+EXTERN unsigned long firstSyncAngle(void) FPAGE_F8;
 
 EXTERN void sleep(unsigned short) FPAGE_FE;
 EXTERN void sleepMicro(unsigned short) FPAGE_FE;
@@ -51,6 +51,7 @@
 #include "inc/pagedLocationBuffers.h"
 #include "inc/init.h"
 #include "inc/decoderInterface.h"
+#include "inc/outputScheduler.h"
 #include <string.h>
 
 
@@ -72,6 +73,7 @@ void init(){
 	initECTTimer();         	/* TODO move this to inside config in an organised way. Set up the timer module and its various aspects */
 	initSCIStuff();         	/* Setup the sci module(s) that we will use. */
 	initConfiguration();    	/* TODO Set user/feature/config up here! */
+	initToothAngleCorrections();	/* Move the decoder's ideal wheel event angles to where the teeth really are */
 	initInterrupts();       	/* still last, reset timers, enable interrupts here TODO move this to inside config in an organised way. Set up the rest of the individual interrupts */
 	ATOMIC_END();           	/* Re-enable any configured interrupts */
 }
@@ -348,6 +350,30 @@ void initTunableAddresses(){
 }
 
 
+/** @brief Correct the wheel event angles
+ *
+ * Add the tunable per tooth corrections to the ideal angles the decoder just
+ * described, once, here. The output scheduler compiles its delays from these
+ * angles in the main loop so the corrections cost nothing at all per tooth.
+ * Event zero is the reference that everything else is measured from, so its
+ * correction is taken off every other one. Any correction that would put an
+ * event at or before the one preceding it is ignored.
+ *
+ * @author Fred Cooke
+ */
+void initToothAngleCorrections(){
+	signed short reference = SmallTablesBFlash.toothAngleCorrections[0];
+	unsigned char wheelEvent;
+	for(wheelEvent = 1;wheelEvent < numberOfWheelEvents;wheelEvent++){
+		signed short correction = SmallTablesBFlash.toothAngleCorrections[wheelEvent] - reference;
+		unsigned short correctedAngle = wheelEventAngles[wheelEvent] + correction;
+		if((correctedAngle > wheelEventAngles[wheelEvent - 1]) && (correctedAngle < wheelEventCycleAngle)){
+			wheelEventAngles[wheelEvent] = correctedAngle;
+		}
+	}
+}
+
+
 /**
  *
  */
@@ -432,26 +458,41 @@ void initVariables(){
 	injectorMainPulseWidthsRealtime = injectorMainPulseWidths1;
 	injectorStagedPulseWidthsMath = injectorStagedPulseWidths0;
 	injectorStagedPulseWidthsRealtime = injectorStagedPulseWidths1;
+	outputEventsMath = &outputEvents0;
+	outputEventsRealtime = &outputEvents1;
 
 	mathSampleTimeStamp = &ISRLatencyVars.mathSampleTimeStamp0; // TODO temp, remove
 	mathSampleTimeStampRecord = &ISRLatencyVars.mathSampleTimeStamp1; // TODO temp, remove
-	RPM = &RPM0; // TODO temp, remove
-	RPMRecord = &RPM1; // TODO temp, remove
 
 	/* Setup the pointers to the registers for fueling use, this does NOT work if done in global.c, I still don't know why. */
-	injectorMainTimeRegisters[0] = TC2_ADDR;
-	injectorMainTimeRegisters[1] = TC3_ADDR;
-	injectorMainTimeRegisters[2] = TC4_ADDR;
-	injectorMainTimeRegisters[3] = TC5_ADDR;
+	/* The injector ISRs use the matching INJECTORn constants in inc/injectionISRs.h instead */
+	injectorMainTimeRegisters[0] = TC1_ADDR;
+	injectorMainTimeRegisters[1] = TC2_ADDR;
+	injectorMainTimeRegisters[2] = TC3_ADDR;
+	injectorMainTimeRegisters[3] = TC4_ADDR;
 	injectorMainTimeRegisters[4] = TC6_ADDR;
 	injectorMainTimeRegisters[5] = TC7_ADDR;
 	injectorMainControlRegisters[0] = TCTL2_ADDR;
 	injectorMainControlRegisters[1] = TCTL2_ADDR;
-	injectorMainControlRegisters[2] = TCTL1_ADDR;
+	injectorMainControlRegisters[2] = TCTL2_ADDR;
 	injectorMainControlRegisters[3] = TCTL1_ADDR;
 	injectorMainControlRegisters[4] = TCTL1_ADDR;
 	injectorMainControlRegisters[5] = TCTL1_ADDR;
 
+	/* Fewer injector groups than channels is group fire, each channel follows the lowest numbered one a multiple of ports away */
+	unsigned char ports = fixedConfigs1.engineSettings.ports;
+	if((ports != 0) && (ports < INJECTION_CHANNELS)){
+		unsigned char channel;
+		for(channel = ports;channel < INJECTION_CHANNELS;channel++){
+			injectorGroupFollowers[channel % ports] |= injectorMainOnMasks[channel];
+			injectorsFollowing |= injectorMainOnMasks[channel];
+		}
+	}
+
+	/* Start both rev limiter walks through the cut patterns at the first bit */
+	fuelCutBit = 1;
+	sparkCutBit = 1;
+
 	configuredBasicDatalogLength = maxBasicDatalogLength;
 
 	// TODO perhaps read from the ds1302 once at start up and init the values or different ones with the actual time and date then update them in RTI
@@ -520,7 +561,7 @@ void initECTTimer(){
 	*/
 	TIOS = 0xDE; /* 0b_1101_1110 - 0 and 5 are input capture, 1 through 4 and 6 and 7 are output compare */
 	TCTL1 = ZEROS; /* Set disabled at startup time, use these and other flags to switch fueling on and off inside the decoder */
-	TCTL2 = ZEROS; /* 0,1 have compare turned off regardless as they are in IC mode. */
+	TCTL2 = ZEROS; /* 0 has compare turned off regardless as it is in IC mode. */
 	TCTL3 = 0x0C; /* Capture on both edges of IC 5 (secondary in), capture off for 4,6,7 */
 	TCTL4 = 0x03; /* Capture on both edges of IC 0 (primary in), capture off for 1,2,3 */
 #endif
@@ -603,6 +644,115 @@ void initConfiguration(){
 		cumulativeConfigErrors++;
 	}
 
+	/* Wheel description larger than the decoder tables built from it */
+	if(fixedConfigs1.engineSettings.primaryTeeth > MAXIMUM_PRIMARY_TEETH){
+		//sendError(WHEEL_TOO_MANY_TEETH);
+		cumulativeConfigErrors++;
+	}
+	if(fixedConfigs1.engineSettings.gapCount > MAXIMUM_WHEEL_GAPS){
+		//sendError(WHEEL_TOO_MANY_GAPS);
+		cumulativeConfigErrors++;
+	}else if(fixedConfigs1.engineSettings.gapCount > 0){
+		/* Gaps must be in order, fit on the wheel and have at least one tooth between each */
+		unsigned char gap;
+		for(gap = 0;gap < fixedConfigs1.engineSettings.gapCount;gap++){
+			unsigned short endOfGap = (unsigned short)fixedConfigs1.engineSettings.gapPositions[gap] + fixedConfigs1.engineSettings.missingTeeth;
+			unsigned short nextGap;
+			if((gap + 1) == fixedConfigs1.engineSettings.gapCount){
+				nextGap = (unsigned short)fixedConfigs1.engineSettings.primaryTeeth + fixedConfigs1.engineSettings.gapPositions[0];
+				if(endOfGap > fixedConfigs1.engineSettings.primaryTeeth){
+					//sendError(WHEEL_GAP_POSITION_INVALID);
+					cumulativeConfigErrors++;
+				}
+			}else{
+				nextGap = fixedConfigs1.engineSettings.gapPositions[gap + 1];
+			}
+			if(endOfGap >= nextGap){
+				//sendError(WHEEL_GAP_POSITION_INVALID);
+				cumulativeConfigErrors++;
+			}
+		}
+	}
+
+	/* Zero counts that the decoders divide by when setting up RPM */
+	if((fixedConfigs1.engineSettings.primaryTeeth == 0) || (fixedConfigs1.engineSettings.revolutionsPerEngineCycle == 0) || (fixedConfigs1.engineSettings.combustionEventsPerEngineCycle == 0)){
+		//sendError(ENGINE_SETTINGS_ZERO_COUNT);
+		cumulativeConfigErrors++;
+	}
+
+	/* RPM averaging window outside the space reserved for it */
+	if((fixedConfigs1.decoderSettings.RPMAveragingTeeth == 0) || (fixedConfigs1.decoderSettings.RPMAveragingTeeth > MAXIMUM_RPM_AVERAGING_TEETH)){
+		//sendError(RPM_AVERAGING_TEETH_INVALID);
+		cumulativeConfigErrors++;
+	}
+
+	/* No stall watchdog, so nothing would ever stop the engine being treated as running */
+	if(fixedConfigs1.decoderSettings.stallTimeoutTeeth == 0){
+		//sendError(STALL_TIMEOUT_INVALID);
+		cumulativeConfigErrors++;
+	}
+
+	/* More cam teeth than there are phase slots for */
+	if(fixedConfigs1.engineSettings.camTeeth > MAXIMUM_CAM_TEETH){
+		//sendError(CAM_TEETH_INVALID);
+		cumulativeConfigErrors++;
+	}
+
+	/* Cam sync takes every cam edge as the same tooth, so there must be only one */
+	if((fixedConfigs1.decoderSettings.camSyncTooth < fixedConfigs1.engineSettings.primaryTeeth) && (fixedConfigs1.engineSettings.camTeeth != 1)){
+		//sendError(CAM_SYNC_TOOTH_INVALID);
+		cumulativeConfigErrors++;
+	}
+
+	/* Decoder type that the all decoders image doesn't have */
+	if(fixedConfigs1.decoderSettings.decoderType >= NUMBER_OF_DECODERS){
+		//sendError(DECODER_TYPE_INVALID);
+		cumulativeConfigErrors++;
+	}
+
+	/* More pulses per over duty injection than there are output events for */
+	if(fixedConfigs1.schedulingSettings.overDutySplits > MAXIMUM_INJECTION_SPLITS){
+		//sendError(OVER_DUTY_SPLITS_INVALID);
+		cumulativeConfigErrors++;
+	}
+
+	/* No injector groups at all or more groups than channels */
+	if((fixedConfigs1.engineSettings.ports == 0) || (fixedConfigs1.engineSettings.ports > INJECTION_CHANNELS)){
+		//sendError(INJECTION_GROUPS_INVALID);
+		cumulativeConfigErrors++;
+	}
+
+	/* Injection angles past the end of the cycle */
+	unsigned char channel;
+	for(channel = 0;channel < INJECTION_CHANNELS;channel++){
+		if(fixedConfigs1.schedulingSettings.injectionAngles[channel] >= ENGINE_CYCLE_ANGLE){
+			//sendError(INJECTION_ANGLE_INVALID);
+			cumulativeConfigErrors++;
+		}
+	}
+
+	/* More coils than ignition channels */
+	if(fixedConfigs1.engineSettings.coils > IGNITION_CHANNELS){
+		//sendError(COIL_COUNT_INVALID);
+		cumulativeConfigErrors++;
+	}
+
+	/* Ignition angles past the end of the cycle */
+	for(channel = 0;channel < IGNITION_CHANNELS;channel++){
+		if(fixedConfigs1.schedulingSettings.ignitionAngles[channel] >= ENGINE_CYCLE_ANGLE){
+			//sendError(IGNITION_ANGLE_INVALID);
+			cumulativeConfigErrors++;
+		}
+	}
+
+	/* Only a checked configuration is safe for the decoder to precompute from */
+	if(cumulativeConfigErrors == 0){
+		decoderInitPreliminary();
+
+		/* Outputs that would land on the same angle of a cycle that the decoder resolves completely */
+		cumulativeConfigErrors += countCollidingOutputAngles();
+	}
+
 	// TODO check all critical variables here!
 
 	/*
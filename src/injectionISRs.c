@@ -53,10 +53,24 @@
 #define InjectorXISR Injector1ISR
 #define STAGEDXOFF STAGED1OFF
 #define STAGEDXON STAGED1ON
+#define INJECTORXTIME INJECTOR1TIME
+#define INJECTORXCONTROL INJECTOR1CONTROL
+#define INJECTORXON INJECTOR1ON
+#define INJECTORXOFF INJECTOR1OFF
+#define INJECTORXGOHIGH INJECTOR1GOHIGH
+#define INJECTORXGOLOW INJECTOR1GOLOW
+#define INJECTORXDISABLE INJECTOR1DISABLE
 #include "inc/injectorISR.c"
 #undef InjectorXISR
 #undef STAGEDXOFF
 #undef STAGEDXON
+#undef INJECTORXTIME
+#undef INJECTORXCONTROL
+#undef INJECTORXON
+#undef INJECTORXOFF
+#undef INJECTORXGOHIGH
+#undef INJECTORXGOLOW
+#undef INJECTORXDISABLE
 #undef INJECTOR_CHANNEL_NUMBER
 
 /* Channel 2 */
@@ -64,10 +78,24 @@
 #define InjectorXISR Injector2ISR
 #define STAGEDXOFF STAGED2OFF
 #define STAGEDXON STAGED2ON
+#define INJECTORXTIME INJECTOR2TIME
+#define INJECTORXCONTROL INJECTOR2CONTROL
+#define INJECTORXON INJECTOR2ON
+#define INJECTORXOFF INJECTOR2OFF
+#define INJECTORXGOHIGH INJECTOR2GOHIGH
+#define INJECTORXGOLOW INJECTOR2GOLOW
+#define INJECTORXDISABLE INJECTOR2DISABLE
 #include "inc/injectorISR.c"
 #undef InjectorXISR
 #undef STAGEDXOFF
 #undef STAGEDXON
+#undef INJECTORXTIME
+#undef INJECTORXCONTROL
+#undef INJECTORXON
+#undef INJECTORXOFF
+#undef INJECTORXGOHIGH
+#undef INJECTORXGOLOW
+#undef INJECTORXDISABLE
 #undef INJECTOR_CHANNEL_NUMBER
 
 /* Channel 3 */
@@ -75,10 +103,24 @@
 #define InjectorXISR Injector3ISR
 #define STAGEDXOFF STAGED3OFF
 #define STAGEDXON STAGED3ON
+#define INJECTORXTIME INJECTOR3TIME
+#define INJECTORXCONTROL INJECTOR3CONTROL
+#define INJECTORXON INJECTOR3ON
+#define INJECTORXOFF INJECTOR3OFF
+#define INJECTORXGOHIGH INJECTOR3GOHIGH
+#define INJECTORXGOLOW INJECTOR3GOLOW
+#define INJECTORXDISABLE INJECTOR3DISABLE
 #include "inc/injectorISR.c"
 #undef InjectorXISR
 #undef STAGEDXOFF
 #undef STAGEDXON
+#undef INJECTORXTIME
+#undef INJECTORXCONTROL
+#undef INJECTORXON
+#undef INJECTORXOFF
+#undef INJECTORXGOHIGH
+#undef INJECTORXGOLOW
+#undef INJECTORXDISABLE
 #undef INJECTOR_CHANNEL_NUMBER
 
 /* Channel 4 */
@@ -86,10 +128,24 @@
 #define InjectorXISR Injector4ISR
 #define STAGEDXOFF STAGED4OFF
 #define STAGEDXON STAGED4ON
+#define INJECTORXTIME INJECTOR4TIME
+#define INJECTORXCONTROL INJECTOR4CONTROL
+#define INJECTORXON INJECTOR4ON
+#define INJECTORXOFF INJECTOR4OFF
+#define INJECTORXGOHIGH INJECTOR4GOHIGH
+#define INJECTORXGOLOW INJECTOR4GOLOW
+#define INJECTORXDISABLE INJECTOR4DISABLE
 #include "inc/injectorISR.c"
 #undef InjectorXISR
 #undef STAGEDXOFF
 #undef STAGEDXON
+#undef INJECTORXTIME
+#undef INJECTORXCONTROL
+#undef INJECTORXON
+#undef INJECTORXOFF
+#undef INJECTORXGOHIGH
+#undef INJECTORXGOLOW
+#undef INJECTORXDISABLE
 #undef INJECTOR_CHANNEL_NUMBER
 
 /* Channel 5 */
@@ -97,10 +153,24 @@
 #define InjectorXISR Injector5ISR
 #define STAGEDXOFF STAGED5OFF
 #define STAGEDXON STAGED5ON
+#define INJECTORXTIME INJECTOR5TIME
+#define INJECTORXCONTROL INJECTOR5CONTROL
+#define INJECTORXON INJECTOR5ON
+#define INJECTORXOFF INJECTOR5OFF
+#define INJECTORXGOHIGH INJECTOR5GOHIGH
+#define INJECTORXGOLOW INJECTOR5GOLOW
+#define INJECTORXDISABLE INJECTOR5DISABLE
 #include "inc/injectorISR.c"
 #undef InjectorXISR
 #undef STAGEDXOFF
 #undef STAGEDXON
+#undef INJECTORXTIME
+#undef INJECTORXCONTROL
+#undef INJECTORXON
+#undef INJECTORXOFF
+#undef INJECTORXGOHIGH
+#undef INJECTORXGOLOW
+#undef INJECTORXDISABLE
 #undef INJECTOR_CHANNEL_NUMBER
 
 /* Channel 6 */
@@ -108,10 +178,148 @@
 #define InjectorXISR Injector6ISR
 #define STAGEDXOFF STAGED6OFF
 #define STAGEDXON STAGED6ON
+#define INJECTORXTIME INJECTOR6TIME
+#define INJECTORXCONTROL INJECTOR6CONTROL
+#define INJECTORXON INJECTOR6ON
+#define INJECTORXOFF INJECTOR6OFF
+#define INJECTORXGOHIGH INJECTOR6GOHIGH
+#define INJECTORXGOLOW INJECTOR6GOLOW
+#define INJECTORXDISABLE INJECTOR6DISABLE
 #include "inc/injectorISR.c"
 #undef InjectorXISR
 #undef STAGEDXOFF
 #undef STAGEDXON
+#undef INJECTORXTIME
+#undef INJECTORXCONTROL
+#undef INJECTORXON
+#undef INJECTORXOFF
+#undef INJECTORXGOHIGH
+#undef INJECTORXGOLOW
+#undef INJECTORXDISABLE
 #undef INJECTOR_CHANNEL_NUMBER
 
 /* If switching to 8 OC channels with non-IC engine input, place two more sets of defines here :-) (along with all the other mods needed of course) */
+
+
+/** @brief Set up group fire followers to match their leader
+ *
+ * With group fire only the leading channel of each group is scheduled and
+ * interrupts. The followers get the same compare time and action with their
+ * interrupts left off, so the timer switches the whole group in the same tick
+ * and one ISR services all of it.
+ *
+ * @author Fred Cooke
+ *
+ * @param followers the TIE style mask of the channels following the leader.
+ * @param time the compare time the leader is set to.
+ * @param switchOn whether the leader is set to switch on or off at that time.
+ */
+void setInjectorGroup(unsigned char followers, unsigned short time, unsigned char switchOn){
+	unsigned char channel;
+	for(channel = 0;(channel < INJECTION_CHANNELS) && followers;channel++){
+		if(followers & injectorMainOnMasks[channel]){
+			followers &= injectorMainOffMasks[channel];
+			if(switchOn){
+				*injectorMainControlRegisters[channel] |= injectorMainEnableMasks[channel];
+			}else{
+				*injectorMainControlRegisters[channel] &= injectorMainGoLowMasks[channel];
+			}
+			*injectorMainTimeRegisters[channel] = time;
+		}
+	}
+}
+
+
+/** @brief Disconnect group fire followers along with their leader
+ *
+ * @author Fred Cooke
+ *
+ * @param followers the TIE style mask of the channels following the leader.
+ */
+void disableInjectorGroup(unsigned char followers){
+	unsigned char channel;
+	for(channel = 0;(channel < INJECTION_CHANNELS) && followers;channel++){
+		if(followers & injectorMainOnMasks[channel]){
+			followers &= injectorMainOffMasks[channel];
+			*injectorMainControlRegisters[channel] &= injectorMainDisableMasks[channel];
+		}
+	}
+}
+
+
+/** @brief Schedule a staged injector switching
+ *
+ * Put the switching in a free slot for the RTI to carry out once the time has
+ * come. This gives the staged injectors scheduled starts and ends without
+ * taking any more timer channels, at the cost of the RTI's resolution. The
+ * caller must first make sure there is a free slot for every switching of the
+ * pulse, so that a start is never queued or carried out without its end.
+ *
+ * @author Fred Cooke
+ *
+ * @param time the extended time to switch at.
+ * @param channelMask the STAGEDXON mask of the output to switch.
+ * @param switchOn whether to switch it on or off.
+ */
+void queueStagedEvent(unsigned long time, unsigned char channelMask, unsigned char switchOn){
+	unsigned char slot;
+	for(slot = 0;slot < STAGED_EVENT_SLOTS;slot++){
+		if(stagedEvents[slot].channelMask == 0){
+			stagedEvents[slot].time = time;
+			stagedEvents[slot].switchOn = switchOn;
+			stagedEvents[slot].channelMask = channelMask;
+			stagedEventsPending++;
+			return;
+		}
+	}
+}
+
+
+/** @brief Forget the pending staged switchings for a channel
+ *
+ * Used when the main injector closes with a fixed staged end, so that a start
+ * still waiting for the RTI can't switch the staged injector on afterwards.
+ *
+ * @author Fred Cooke
+ *
+ * @param channelMask the STAGEDXON mask of the output to forget.
+ */
+void cancelStagedEvents(unsigned char channelMask){
+	unsigned char slot;
+	for(slot = 0;(slot < STAGED_EVENT_SLOTS) && stagedEventsPending;slot++){
+		if(stagedEvents[slot].channelMask == channelMask){
+			stagedEvents[slot].channelMask = 0;
+			stagedEventsPending--;
+		}
+	}
+}
+
+
+/** @brief Carry out the staged switchings that are due
+ *
+ * Called from the RTI while any are pending. Each slot whose time is now or
+ * behind us switches its output and is freed.
+ *
+ * @author Fred Cooke
+ */
+void serviceStagedEvents(){
+	unsigned short timerCount = TCNT;
+	LongTime now;
+	EXTEND_TIME_STAMP(now, timerCount);
+
+	unsigned char slot;
+	for(slot = 0;slot < STAGED_EVENT_SLOTS;slot++){
+		unsigned char channelMask = stagedEvents[slot].channelMask;
+		if((channelMask != 0) && ((now.timeLong - stagedEvents[slot].time) < LONGHALF)){
+			if(stagedEvents[slot].switchOn){
+				STAGEDPORT |= channelMask;
+				stagedOn |= channelMask;
+			}else{
+				STAGEDPORT &= (unsigned char)~channelMask;
+				stagedOn &= (unsigned char)~channelMask;
+			}
+			stagedEvents[slot].channelMask = 0;
+			stagedEventsPending--;
+		}
+	}
+}
@@ -66,6 +66,21 @@ int  main(){ // TODO maybe move this to paged flash ?
 	// Run forever repeating.
 	while(TRUE){
 	//	unsigned short start = realTimeClockMillis;
+		/* If the teeth have stopped, forget everything about the engine turning */
+		if(coreStatusA & STALLED){
+			ATOMIC_START(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+			/* A tooth may have rearmed the watchdog since the flag was set, only act if it hasn't */
+			if(Clocks.toothStallClock == 0){
+				resetToNonRunningState();
+				Counters.toothStalls++;
+
+				/* Set flag to say calc required */
+				coreStatusA |= CALC_FUEL_IGN;
+			}
+			coreStatusA &= CLEAR_STALLED;
+			ATOMIC_END(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+		}
+
 		/* If ADCs require forced sampling, sample now */
 		if(coreStatusA & FORCE_READING){
 			ATOMIC_START(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
@@ -76,7 +91,6 @@ int  main(){ // TODO maybe move this to paged flash ?
 
 				sampleEachADC(ADCArraysRecord); // TODO still need to do a pair of loops and clock these two functions for performance.
 				//sampleLoopADC(&ADCArrays);
-				resetToNonRunningState();
 				Counters.timeoutADCreadings++;
 
 				/* Set flag to say calc required */
@@ -96,15 +110,11 @@ int  main(){ // TODO maybe move this to paged flash ?
 
 			/* Switch input bank so that we have a stable set of the latest data */
 			if(ADCArrays == &ADCArrays1){
-				RPM = &RPM0; // TODO temp, remove
-				RPMRecord = &RPM1; // TODO temp, remove
 				ADCArrays = &ADCArrays0;
 				ADCArraysRecord = &ADCArrays1;
 				mathSampleTimeStamp = &ISRLatencyVars.mathSampleTimeStamp0; // TODO temp, remove
 				mathSampleTimeStampRecord = &ISRLatencyVars.mathSampleTimeStamp1; // TODO temp, remove
 			}else{
-				RPM = &RPM1; // TODO temp, remove
-				RPMRecord = &RPM0; // TODO temp, remove
 				ADCArrays = &ADCArrays1;
 				ADCArraysRecord = &ADCArrays0;
 				mathSampleTimeStamp = &ISRLatencyVars.mathSampleTimeStamp1; // TODO temp, remove
@@ -130,7 +140,7 @@ int  main(){ // TODO maybe move this to paged flash ?
 			unsigned short derivedStartTime = TCNT;
 
 			/* Generate the derived variables from the core variables based on settings */
-			//generateDerivedVars();
+			generateDerivedVars();
 
 			RuntimeVars.genDerivedVarsRuntime = TCNT - derivedStartTime;
 			unsigned short calcsStartTime = TCNT;
@@ -138,6 +148,12 @@ int  main(){ // TODO maybe move this to paged flash ?
 			/* Perform the calculations TODO possibly move this to the software interrupt if it makes sense to do so */
 			//calculateFuelAndIgnition();
 
+			/* Dwell for the coming sparks, the output events are made from it */
+			calculateDwell();
+
+			/* Turn the angles into per wheel event lists at the current RPM */
+			generateOutputEvents();
+
 			RuntimeVars.calcsRuntime = TCNT - calcsStartTime;
 			/* Record the runtime of all the math total */
 			RuntimeVars.mathTotalRuntime = TCNT - mathStartTime;
@@ -155,6 +171,8 @@ int  main(){ // TODO maybe move this to paged flash ?
 				injectorMainPulseWidthsRealtime = injectorMainPulseWidths1;
 				injectorStagedPulseWidthsMath = injectorStagedPulseWidths0;
 				injectorStagedPulseWidthsRealtime = injectorStagedPulseWidths1;
+				outputEventsMath = &outputEvents0;
+				outputEventsRealtime = &outputEvents1;
 			}else{
 				currentDwellMath = &currentDwell1;
 				currentDwellRealtime = &currentDwell0;
@@ -162,6 +180,8 @@ int  main(){ // TODO maybe move this to paged flash ?
 				injectorMainPulseWidthsRealtime = injectorMainPulseWidths0;
 				injectorStagedPulseWidthsMath = injectorStagedPulseWidths1;
 				injectorStagedPulseWidthsRealtime = injectorStagedPulseWidths0;
+				outputEventsMath = &outputEvents1;
+				outputEventsRealtime = &outputEvents0;
 			}
 
 			ATOMIC_END(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
@@ -180,6 +200,9 @@ int  main(){ // TODO maybe move this to paged flash ?
 
 				/* Handle the incoming packet */
 				decodePacketAndRespond();
+			}else if((asyncDatalogType == asyncDatalogTrigger) && !(SCI0CR2 & SCICR2_TX_ISR_ENABLE)){
+				/* Stream the trigger log out whenever the port is free */
+				sendTriggerLog();
 			}//else if(lastCalcCount != Counters.calculationsPerformed){ // substitute true for full speed continuous stream test...
 
 				/* send asynchronous data log if required */
@@ -225,7 +248,7 @@ int  main(){ // TODO maybe move this to paged flash ?
 //					}
 //					case asyncDatalogTrigger:
 //					{
-//						/// TODO @todo
+//						/* Handled above by sendTriggerLog() */
 //						break;
 //					}
 //					case asyncDatalogADC:
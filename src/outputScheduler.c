@@ -0,0 +1,521 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file outputScheduler.c
+ * @ingroup measurementsAndCalculations
+ *
+ * @brief Angle domain output scheduling
+ *
+ * The main loop half of this file turns the configured output angles into a
+ * list of wheel events and delays in fractions of a tooth period. It also
+ * deals with pulses too long for the engine speed, either splitting them or
+ * holding the injector open with no ISRs at all. With group fire only the
+ * leading channel of each group gets events, its followers are set up with it
+ * and switch in the same tick without ISRs of their own. Coils get one event
+ * each, from the wheel event before their dwell starts. The ISR
+ * half is called by the decoders on each wheel event, turns those fractions
+ * into ticks with the tooth period extrapolated to the coming tooth and arms
+ * only the outputs that belong to the event. All of the division is done in
+ * the main loop, the decoder side is a short compare loop, two small
+ * multiplies and a few register writes per output.
+ *
+ * @author Fred Cooke
+ */
+
+
+#define OUTPUTSCHEDULER_C
+#include "inc/FreeMS2.h"
+#include "inc/interrupts.h"
+#include "inc/decoderInterface.h"
+#include "inc/outputScheduler.h"
+#include "inc/injectionISRs.h"
+#include "inc/ignitionISRs.h"
+#include "inc/derivedVarsGenerator.h"
+
+
+/** @brief Hold injectors open or let them go
+ *
+ * A channel that becomes held has its interrupt disabled, its queue emptied
+ * and its compare forced to switch on, so it stays open with no ISR running
+ * until it is released. A released channel is forced off and disconnected,
+ * ready for the scheduler to arm from scratch.
+ *
+ * @author Fred Cooke
+ *
+ * @param heldOpen the TIE style mask of channels that should be held open.
+ */
+static void setInjectorsHeldOpen(unsigned char heldOpen){
+	unsigned char changed = heldOpen ^ injectorsHeldOpen;
+	unsigned char channel;
+	for(channel = 0;(channel < INJECTION_CHANNELS) && changed;channel++){
+		unsigned char mask = injectorMainOnMasks[channel];
+		if(!(changed & mask)){
+			continue;
+		}
+		changed &= injectorMainOffMasks[channel];
+
+		ATOMIC_START(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+		TIE &= injectorMainOffMasks[channel];
+		injectionQueueHeads[channel] = injectionQueueTails[channel];
+		if(heldOpen & mask){
+			*injectorMainControlRegisters[channel] |= injectorMainEnableMasks[channel];
+			CFORC = mask;
+			injectorsHeldOpen |= mask;
+		}else{
+			*injectorMainControlRegisters[channel] &= injectorMainGoLowMasks[channel];
+			CFORC = mask;
+			*injectorMainControlRegisters[channel] &= injectorMainDisableMasks[channel];
+			injectorsHeldOpen &= injectorMainOffMasks[channel];
+		}
+		ATOMIC_END(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+	}
+}
+
+
+/** @brief Find the last wheel event at or before an output angle
+ *
+ * @author Fred Cooke
+ *
+ * @param angle the angle after wheel event zero, less than outputCycleAngle.
+ *
+ * @return the wheel event, those of a second wheel event cycle numbered on from numberOfWheelEvents.
+ */
+static unsigned char wheelEventBefore(unsigned short angle){
+	unsigned char offset = 0;
+	if(angle >= wheelEventCycleAngle){
+		angle -= wheelEventCycleAngle;
+		offset = numberOfWheelEvents;
+	}
+
+	/* Event zero is always at zero angle, so this stops there at worst */
+	unsigned char wheelEvent = numberOfWheelEvents - 1;
+	while(wheelEventAngles[wheelEvent] > angle){
+		wheelEvent--;
+	}
+	return wheelEvent + offset;
+}
+
+
+/** @brief Find the output angle of a wheel event
+ *
+ * @author Fred Cooke
+ *
+ * @param wheelEvent the wheel event, as numbered by wheelEventBefore().
+ *
+ * @return the angle after wheel event zero.
+ */
+static unsigned short wheelEventAngle(unsigned char wheelEvent){
+	if(wheelEvent >= numberOfWheelEvents){
+		return wheelEventAngles[wheelEvent - numberOfWheelEvents] + wheelEventCycleAngle;
+	}else{
+		return wheelEventAngles[wheelEvent];
+	}
+}
+
+
+/** @brief Count outputs configured onto the same angle
+ *
+ * Only meaningful once the decoder has set outputCycleAngle. A decoder that
+ * resolves the whole engine cycle fires each output once per cycle, so two
+ * injector groups or two coils on the same angle there can only be a config
+ * mistake. A decoder with a shorter cycle fires every output once per its own
+ * cycle, and outputs that fold onto the same point of it fire together, which
+ * is the batch fire and wasted spark that such a wheel gives, so those are
+ * allowed.
+ *
+ * @author Fred Cooke
+ *
+ * @return the number of colliding pairs, for initConfiguration to count as errors.
+ */
+unsigned char countCollidingOutputAngles(){
+	if(outputCycleAngle != ENGINE_CYCLE_ANGLE){
+		return 0;
+	}
+
+	unsigned char collisions = 0;
+	unsigned char channel;
+	unsigned char other;
+	for(channel = 0;channel < fixedConfigs1.engineSettings.ports;channel++){
+		for(other = channel + 1;other < fixedConfigs1.engineSettings.ports;other++){
+			if(fixedConfigs1.schedulingSettings.injectionAngles[channel] == fixedConfigs1.schedulingSettings.injectionAngles[other]){
+				//sendError(INJECTION_ANGLE_INVALID);
+				collisions++;
+			}
+		}
+	}
+	for(channel = 0;channel < fixedConfigs1.engineSettings.coils;channel++){
+		for(other = channel + 1;other < fixedConfigs1.engineSettings.coils;other++){
+			if(fixedConfigs1.schedulingSettings.ignitionAngles[channel] == fixedConfigs1.schedulingSettings.ignitionAngles[other]){
+				//sendError(IGNITION_ANGLE_INVALID);
+				collisions++;
+			}
+		}
+	}
+	return collisions;
+}
+
+
+/** @brief Order an output event list by wheel event and index it
+ *
+ * A stable insertion sort, so that events of one wheel event keep the order
+ * they were added in, then the first event of each wheel event is recorded.
+ * Wheel events with no events point at the next one that has some, or the end.
+ *
+ * @author Fred Cooke
+ *
+ * @param list the list to order and index.
+ */
+static void indexOutputEvents(outputEventList* list){
+	unsigned char index;
+	for(index = 1;index < list->count;index++){
+		outputEvent event = list->events[index];
+		unsigned char slot = index;
+		while((slot > 0) && (list->events[slot - 1].wheelEvent > event.wheelEvent)){
+			list->events[slot] = list->events[slot - 1];
+			slot--;
+		}
+		list->events[slot] = event;
+	}
+
+	unsigned char wheelEvent;
+	index = 0;
+	for(wheelEvent = 0;wheelEvent < OUTPUT_EVENT_INDEX_LENGTH;wheelEvent++){
+		while((index < list->count) && (list->events[index].wheelEvent < wheelEvent)){
+			index++;
+		}
+		list->firstEvents[wheelEvent] = index;
+	}
+}
+
+
+/** @brief Compile the output event list
+ *
+ * For each injection channel find the wheel event at or before its angle and
+ * the delay from that event in 256ths of a tooth period. The result goes into
+ * the math bank and is swapped in with the pulsewidths, so the decoder always
+ * sees a complete list. No RPM or no wheel event description means no events.
+ * The events are kept in wheel event order with an index to the first of each
+ * so that the decoder only looks at its own tooth's events.
+ * Angles repeat every outputCycleAngle, which a decoder with cam phase makes
+ * two wheel event cycles long. Outputs that fold onto one angle of a shorter
+ * cycle fire together, see countCollidingOutputAngles().
+ *
+ * A pulse longer than maximumInjectorDuty of the time between pulses is over
+ * duty. If overDutySplits allows it and the pulse still fits between pulses,
+ * it is delivered as that many shorter pulses spread evenly over the cycle.
+ * Otherwise the channel is held open with no events at all, which saves an
+ * ISR storm of pulses that would barely close before opening again.
+ *
+ * Group fire followers get no events of their own and are held open along with
+ * their leader, the leader's pulse width serving the whole group.
+ *
+ * Each coil gets one event for its dwell, from the last wheel event before its
+ * dwell would start at the current RPM, so that both times are known when it
+ * is scheduled. If a later wheel event comes before the spark angle the coil
+ * gets a second event there that retimes the spark from that wheel event's
+ * fresher tooth period. No dwell means no coil events at all. Below
+ * multiSparkRPM each spark is followed by as many of multiSparks as fit before
+ * the coil's next dwell, each with the dwell bounded by the maximum for the RPM.
+ *
+ * Over revLimitRPM the rev limiter engages for whichever of FUEL_CUT_ENABLED
+ * and SOFT_SPARK_CUT_ENABLED are set in coreSettingsA, and lets go again once
+ * RPM is REV_LIMIT_HYSTERESIS below it, or zero for a limit lower than that. While engaged the list carries the cut pattern
+ * for revLimitCut so that the decoder only has to test one bit per event.
+ *
+ * @author Fred Cooke
+ */
+void generateOutputEvents(){
+	outputEventList* list = outputEventsMath;
+	list->count = 0;
+	list->extraSparks = 0;
+
+	/* Rev limiter, on above revLimitRPM and off once back under it by the hysteresis */
+	unsigned short revLimitRPM = fixedConfigs1.schedulingSettings.revLimitRPM;
+	unsigned short revLimitReleaseRPM = 0;
+	if(revLimitRPM > REV_LIMIT_HYSTERESIS){
+		revLimitReleaseRPM = revLimitRPM - REV_LIMIT_HYSTERESIS;
+	}
+	unsigned short cutsEnabled = 0;
+	if(revLimitRPM != 0){
+		if(fixedConfigs1.coreSettingsA & FUEL_CUT_ENABLED){
+			cutsEnabled |= FUEL_CUT;
+		}
+		if(fixedConfigs1.coreSettingsA & SOFT_SPARK_CUT_ENABLED){
+			cutsEnabled |= SOFT_SPARK_CUT;
+		}
+	}
+	if(cutsEnabled && (CoreVars->RPM > revLimitRPM)){
+		if(!(coreStatusA & cutsEnabled)){
+			Counters.revLimiterEngagements++;
+		}
+		ATOMIC_START(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+		coreStatusA |= cutsEnabled;
+		ATOMIC_END(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+	}else if(!cutsEnabled || (CoreVars->RPM < revLimitReleaseRPM)){
+		ATOMIC_START(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+		coreStatusA &= (CLEAR_FUEL_CUT & CLEAR_SOFT_SPARK_CUT);
+		ATOMIC_END(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+	}
+	unsigned char revLimitCut = fixedConfigs1.schedulingSettings.revLimitCut;
+	if(revLimitCut > REV_LIMIT_CUT_STEPS){
+		revLimitCut = REV_LIMIT_CUT_STEPS;
+	}
+	list->fuelCutPattern = (coreStatusA & FUEL_CUT) ? revLimitCutPatterns[revLimitCut] : 0;
+	list->sparkCutPattern = (coreStatusA & SOFT_SPARK_CUT) ? revLimitCutPatterns[revLimitCut] : 0;
+
+	/* Without RPM there is no way to turn angle into time, nor any reason to hold an injector open */
+	if((numberOfWheelEvents == 0) || (toothPeriodAngle == 0) || (outputCycleAngle == 0) || (CoreVars->RPM == 0)){
+		indexOutputEvents(list);
+		setInjectorsHeldOpen(0);
+		return;
+	}
+
+	/* Ticks between successive pulses on one channel, and the longest pulse that isn't over duty */
+	unsigned long pulsePeriod = ((ticksPerCycleAtOneRPMx2 / ENGINE_CYCLE_ANGLE) * outputCycleAngle) / CoreVars->RPM;
+	unsigned long maximumPulseWidth = LONGMAX;
+	if(fixedConfigs1.schedulingSettings.maximumInjectorDuty != 0){
+		maximumPulseWidth = (pulsePeriod >> 8) * fixedConfigs1.schedulingSettings.maximumInjectorDuty;
+	}
+
+	unsigned char heldOpen = 0;
+	unsigned char channel;
+	for(channel = 0;channel < INJECTION_CHANNELS;channel++){
+		if(injectorsFollowing & injectorMainOnMasks[channel]){
+			continue;
+		}
+
+		unsigned short pulseWidth = injectorMainPulseWidthsMath[channel];
+		unsigned char pulses = 1;
+		if(pulseWidth > maximumPulseWidth){
+			if((fixedConfigs1.schedulingSettings.overDutySplits > 1) && (pulseWidth < pulsePeriod)){
+				pulses = fixedConfigs1.schedulingSettings.overDutySplits;
+				if(pulses > MAXIMUM_INJECTION_SPLITS){
+					pulses = MAXIMUM_INJECTION_SPLITS;
+				}
+				pulseWidth /= pulses;
+			}else{
+				heldOpen |= injectorMainOnMasks[channel] | injectorGroupFollowers[channel];
+				continue;
+			}
+		}
+
+		unsigned char pulse;
+		for(pulse = 0;pulse < pulses;pulse++){
+			/* Fold the angle into the part of the cycle that the wheel events cover */
+			unsigned short angle = ((unsigned long)fixedConfigs1.schedulingSettings.injectionAngles[channel] + (((unsigned long)outputCycleAngle * pulse) / pulses)) % outputCycleAngle;
+			unsigned char wheelEvent = wheelEventBefore(angle);
+
+			/* Independent of RPM, the decoder knows how long a tooth is about to take */
+			unsigned long toothFraction = ((unsigned long)(angle - wheelEventAngle(wheelEvent)) << 8) / toothPeriodAngle;
+			if(toothFraction > SHORTMAX){
+				toothFraction = SHORTMAX;
+			}
+
+			list->events[list->count].wheelEvent = wheelEvent;
+			list->events[list->count].channel = channel;
+			list->events[list->count].toothFraction = (unsigned short)toothFraction;
+			list->events[list->count].pulseWidth = pulseWidth;
+			list->count++;
+		}
+	}
+
+	/* Dwell as angle at this RPM, and never so long that the coil can't fire before dwelling again */
+	unsigned short dwell = *currentDwellMath;
+	if(dwell != 0){
+		unsigned long dwellAngle = ((unsigned long)dwell * outputCycleAngle) / pulsePeriod;
+		if(dwellAngle >= outputCycleAngle){
+			dwellAngle = outputCycleAngle - 1;
+		}
+
+		/* Cranking, more sparks after each one for as many as fit before the coil dwells again */
+		if((CoreVars->RPM < fixedConfigs1.schedulingSettings.multiSparkRPM) && (fixedConfigs1.schedulingSettings.multiSparks > 1)){
+			unsigned short extraSparkDwell = lookupMaximumDwell(CoreVars->RPM);
+			if(extraSparkDwell > dwell){
+				extraSparkDwell = dwell;
+			}
+			unsigned long extraSparkPeriod = (unsigned long)fixedConfigs1.schedulingSettings.multiSparkGap + extraSparkDwell;
+			unsigned char extraSparks = fixedConfigs1.schedulingSettings.multiSparks - 1;
+			while(extraSparks && (((extraSparkPeriod * extraSparks) + dwell) >= pulsePeriod)){
+				extraSparks--;
+			}
+			list->extraSparks = extraSparks;
+			list->extraSparkDwell = extraSparkDwell;
+		}
+
+		unsigned char coil;
+		for(coil = 0;(coil < fixedConfigs1.engineSettings.coils) && (coil < IGNITION_CHANNELS);coil++){
+			unsigned short sparkAngle = (((unsigned long)fixedConfigs1.schedulingSettings.ignitionAngles[coil] + ENGINE_CYCLE_ANGLE) - ignitionAdvances[coil]) % outputCycleAngle;
+			unsigned short dwellAngleStart = (((unsigned long)sparkAngle + outputCycleAngle) - dwellAngle) % outputCycleAngle;
+			unsigned char wheelEvent = wheelEventBefore(dwellAngleStart);
+			unsigned char sparkWheelEvent = wheelEventBefore(sparkAngle);
+
+			/* Often many teeth away, all of it goes in the one fraction so that it is only rounded once */
+			unsigned long sparkAngleAfterEvent = (((unsigned long)sparkAngle + outputCycleAngle) - wheelEventAngle(wheelEvent)) % outputCycleAngle;
+			unsigned long toothFraction = (sparkAngleAfterEvent << 8) / toothPeriodAngle;
+			if(toothFraction > SHORTMAX){
+				toothFraction = SHORTMAX;
+			}
+
+			list->events[list->count].wheelEvent = wheelEvent;
+			list->events[list->count].channel = coil | IGNITION_EVENT;
+			list->events[list->count].toothFraction = (unsigned short)toothFraction;
+			list->events[list->count].pulseWidth = 0;
+			list->count++;
+
+			/* Same wheel event or none between, the spark is as fresh as it gets already */
+			if(sparkWheelEvent != wheelEvent){
+				toothFraction = ((unsigned long)(sparkAngle - wheelEventAngle(sparkWheelEvent)) << 8) / toothPeriodAngle;
+				if(toothFraction > SHORTMAX){
+					toothFraction = SHORTMAX;
+				}
+
+				list->events[list->count].wheelEvent = sparkWheelEvent;
+				list->events[list->count].channel = coil | IGNITION_EVENT | SPARK_ANCHOR_EVENT;
+				list->events[list->count].toothFraction = (unsigned short)toothFraction;
+				list->events[list->count].pulseWidth = 0;
+				list->count++;
+			}
+		}
+	}
+
+	indexOutputEvents(list);
+	setInjectorsHeldOpen(heldOpen);
+}
+
+
+/** @brief Arm the outputs for a wheel event
+ *
+ * Called from the decoder ISRs with sync. Walks this wheel event's slice of the
+ * realtime list and sets up the compare for each injection channel in it. If
+ * the channel is still busy with an earlier pulse the start and width are
+ * added to its queue, and the channel ISR sets each one up as it switches off.
+ * Group fire followers are armed along with their leader, interrupts off.
+ * A full queue drops the pulse and counts it. Coils are put in the ignition
+ * queues with their spark time and a dwell start the realtime dwell before it,
+ * and the spark is moved to a fresher time by the wheel event before it if any.
+ * Each kind of event steps one bit through its rev limiter cut pattern and is
+ * dropped when that bit is set, so the cuts move round robin across channels.
+ *
+ * @author Fred Cooke
+ *
+ * @param wheelEvent the wheel event just seen.
+ * @param timeStamp the extended time stamp of the edge that caused it.
+ */
+void scheduleOutputEvents(unsigned char wheelEvent, unsigned long timeStamp){
+	// use reference PW to decide whether to fuel at all
+	unsigned char fuelling = (masterPulseWidth > injectorMinimumPulseWidth);
+
+	if(wheelEvent >= (OUTPUT_EVENT_INDEX_LENGTH - 1)){
+		return;
+	}
+
+	outputEventList* list = outputEventsRealtime;
+	unsigned char lastEvent = list->firstEvents[wheelEvent + 1];
+	unsigned char index;
+	for(index = list->firstEvents[wheelEvent];index < lastEvent;index++){
+		unsigned char fuelChannel = list->events[index].channel;
+		unsigned char ignition = fuelChannel & IGNITION_EVENT;
+
+		/* No fuel to give, or held open by the main loop since the list was made */
+		if(!ignition && (!fuelling || (injectorsHeldOpen & injectorMainOnMasks[fuelChannel]))){
+			continue;
+		}
+
+		/* Rev limiter, a single bit test against the pattern the main loop left us, a spark retime goes with its dwell */
+		if(!ignition){
+			unsigned short cutBit = fuelCutBit;
+			fuelCutBit = (cutBit << 1) | (cutBit >> 15);
+			if(list->fuelCutPattern & cutBit){
+				Counters.revLimiterFuelCuts++;
+				continue;
+			}
+		}else if(!(fuelChannel & SPARK_ANCHOR_EVENT)){
+			unsigned short cutBit = sparkCutBit;
+			sparkCutBit = (cutBit << 1) | (cutBit >> 15);
+			if(list->sparkCutPattern & cutBit){
+				Counters.revLimiterSparkCuts++;
+				continue;
+			}
+		}
+
+		/* Two sixteen by sixteen multiplies, and a tooth too long for them is past anything we could schedule anyway */
+		unsigned short toothFraction = list->events[index].toothFraction;
+		unsigned long periodHigh = predictedToothPeriod >> 8;
+		unsigned long delay = SHORTMAX;
+		if(periodHigh <= SHORTMAX){
+			delay = (periodHigh * toothFraction) + (((predictedToothPeriod & 0xFF) * toothFraction) >> 8);
+		}
+
+		/* Coils are switched from 32 bit times, so the delay may go past what a compare could reach */
+		if(ignition){
+			unsigned long sparkTime = timeStamp + delay;
+			unsigned char coil = fuelChannel & (unsigned char)~(IGNITION_EVENT | SPARK_ANCHOR_EVENT);
+			if(fuelChannel & SPARK_ANCHOR_EVENT){
+				retimeIgnitionEvent(coil, sparkTime);
+			}else{
+				queueIgnitionEvent(coil, sparkTime - *currentDwellRealtime, sparkTime, list->extraSparks);
+			}
+			continue;
+		}
+
+		/* Stay inside what a single compare can reach and more than code time away */
+		if(delay > SHORTMAX){
+			delay = SHORTMAX;
+		}else if(delay < trailingEdgeSecondaryRPMInputCodeTime){
+			delay = trailingEdgeSecondaryRPMInputCodeTime;
+		}
+
+		// determine the long and short start times
+		unsigned short startTime = (unsigned short)timeStamp + (unsigned short)delay;
+		unsigned long startTimeLong = timeStamp + delay;
+
+		// determine whether or not to reschedule
+		unsigned char reschedule = 0;
+		unsigned long diff = startTimeLong - (injectorMainEndTimes[fuelChannel] + injectorSwitchOffCodeTime);
+		if(diff > LONGHALF){
+			reschedule = 1;
+		}
+
+		// schedule the appropriate channel
+		if(!(*injectorMainControlRegisters[fuelChannel] & injectorMainEnableMasks[fuelChannel]) || reschedule){ /* If the timer isn't still running, or if its set too long, set it to start again at the right time soon */
+			injectorArmedPulseWidths[fuelChannel] = list->events[index].pulseWidth;
+			*injectorMainControlRegisters[fuelChannel] |= injectorMainEnableMasks[fuelChannel];
+			*injectorMainTimeRegisters[fuelChannel] = startTime;
+			TIE |= injectorMainOnMasks[fuelChannel];
+			TFLG = injectorMainOnMasks[fuelChannel];
+			if(injectorGroupFollowers[fuelChannel]){
+				setInjectorGroup(injectorGroupFollowers[fuelChannel], startTime, TRUE);
+			}
+		}else if((unsigned char)(injectionQueueTails[fuelChannel] - injectionQueueHeads[fuelChannel]) < INJECTION_QUEUE_LENGTH){
+			injectionEvent* queued = &injectionQueues[fuelChannel][injectionQueueTails[fuelChannel] & INJECTION_QUEUE_MASK];
+			queued->startTime = startTimeLong;
+			queued->pulseWidth = list->events[index].pulseWidth;
+			injectionQueueTails[fuelChannel]++; // only now that the slot is complete, the channel ISR may take it
+		}else{
+			Counters.injectionEventsDropped++;
+		}
+	}
+}
@@ -41,6 +41,8 @@
 #include "inc/FreeMS2.h"
 #include "inc/interrupts.h"
 #include "inc/commsISRs.h"
+#include "inc/injectionISRs.h"
+#include "inc/ignitionISRs.h"
 
 
 /** @brief Real Time Interrupt Handler
@@ -60,6 +62,24 @@ void RTIISR(){
 	/* Increment the counter */
 	Clocks.realTimeClockMain++;
 
+	/* Switch any staged injectors whose time has come */
+	if(stagedEventsPending){
+		serviceStagedEvents();
+	}
+
+	/* Dwell and fire any coils whose time has come */
+	if(dwellQueueLength || ignitionQueueLength){
+		serviceIgnitionEvents();
+	}
+
+	/* Count down the stall watchdog every RTI so a stall is seen within a tooth or so of the timeout */
+	if(Clocks.toothStallClock != 0){
+		Clocks.toothStallClock--;
+		if(Clocks.toothStallClock == 0){
+			coreStatusA |= STALLED;
+		}
+	}
+
 	/* This function could be performed without the extra variables by rolling over the main ones at the largest multiples of the next ones, but I'm not sure thats better */
 
 	// TODO add content to eighths of a milli RTC ?
@@ -0,0 +1,73 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file hostTarget.h
+ *
+ * @brief Host stand ins for the target only parts of the headers
+ *
+ * Force included ahead of everything else when a decoder is built for the
+ * replay harness. Registers are redirected into a plain block of memory that
+ * the harness writes before calling an ISR and reads afterwards. Interrupt
+ * masking becomes a no op because nothing is concurrent on the host. The
+ * target has 16 bit ints and 32 bit longs and is big endian, so longs are
+ * mapped to ints and the time stamp union is told to store big endian, which
+ * keeps timeShorts[0] the high word exactly as on the chip.
+ *
+ * @author Fred Cooke
+ */
+
+
+#ifndef FILE_HOSTTARGET_H_SEEN
+#define FILE_HOSTTARGET_H_SEEN
+
+
+#define HOST_REGISTER_SPACE 0x0400	/* 0x0000 to 0x03FF on the C128 */
+extern unsigned char hostRegisters[HOST_REGISTER_SPACE];
+
+#define DVUCP(address) (*((volatile unsigned char*)(hostRegisters + (address))))
+#define DVUSP(address) (*((volatile unsigned short*)(hostRegisters + (address))))
+#define AVUCP(address) ((volatile unsigned char*)(hostRegisters + (address)))
+#define AVUSP(address) ((volatile unsigned short*)(hostRegisters + (address)))
+
+#define INT
+#define ATOMIC_START()
+#define ATOMIC_END()
+
+#define BIG_ENDIAN_LAYOUT __attribute__ ((scalar_storage_order ("big-endian")))
+
+/* Must come after any system headers, so pull in the ones the firmware and harness use first */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#define long int
+
+
+#else
+	/* let us know if we are being untidy with headers */
+	#warning "Header file HOSTTARGET_H seen before, sort it out!"
+/* end of the wrapper ifdef from the very top */
+#endif
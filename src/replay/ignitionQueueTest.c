@@ -0,0 +1,168 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file ignitionQueueTest.c
+ *
+ * @brief Host test of the coil dwell and spark queues
+ *
+ * Dwell starts and sparks are queued for one coil and the RTI is run every RTI
+ * period, noting when the coil switched. Each switching must happen at the
+ * first RTI at or after its time and never before it. A spark retimed before
+ * its dwell has started must take the dwell with it, earlier or later, so the
+ * dwell always comes first and lasts as long as it did. A spark retimed after
+ * its dwell started must move alone, and a pending dwell that belongs to the
+ * next spark must be left where it is. A coil switching that doesn't fit must
+ * be dropped whole and counted.
+ *
+ * Run by "make hosttests", exits non zero if any check fails.
+ *
+ * @author Fred Cooke
+ */
+
+
+#include "../inc/FreeMS2.h"
+#include "../inc/interrupts.h"
+#include "../inc/ignitionISRs.h"
+
+
+#define TEST_COIL 0
+#define TEST_DWELL 3000
+
+
+/* The simulated register block that hostTarget.h points everything at */
+unsigned char hostRegisters[HOST_REGISTER_SPACE];
+
+
+static unsigned int failures;
+
+#define CHECK(condition)                                           \
+	if(!(condition)){                                              \
+		printf("Failed at line %d : %s\n", __LINE__, #condition);  \
+		failures++;                                                \
+	}
+
+/* True if time is at or up to one RTI period after when */
+#define WITHIN_ONE_RTI(time, when) ((unsigned short)((time) - (when)) < RTI_PERIOD_TICKS)
+
+
+static unsigned short now;				/* When the last RTI ran */
+static unsigned short dwellStartedAt;	/* When the coil last switched on, zero if it hasn't since the last check */
+static unsigned short sparkedAt;		/* When the coil last switched off, zero if it hasn't since the last check */
+
+
+/* Run the RTI every RTI period up to a time, noting when the coil switches */
+static void runUntil(unsigned short until){
+	while((unsigned short)(until - now) >= RTI_PERIOD_TICKS){
+		unsigned short wasOn = dwellOn & dwellStartMasks[TEST_COIL];
+		now += RTI_PERIOD_TICKS;
+		TCNT = now;
+		RTIISR();
+		unsigned short isOn = dwellOn & dwellStartMasks[TEST_COIL];
+		if(isOn && !wasOn){
+			dwellStartedAt = now;
+		}
+		if(!isOn && wasOn){
+			sparkedAt = now;
+		}
+	}
+}
+
+
+/* Forget all of the above for the next case */
+static void startCase(){
+	releaseIgnitionOutputs();
+	dwellStartedAt = 0;
+	sparkedAt = 0;
+	now = 1000;
+}
+
+
+int main(){
+	/* On time, each at the first RTI at or after it */
+	startCase();
+	queueIgnitionEvent(TEST_COIL, 2000, 2000 + TEST_DWELL, 0);
+	runUntil(10000);
+	printf("Unmoved, dwell from %u to %u\n", dwellStartedAt, sparkedAt);
+	CHECK(WITHIN_ONE_RTI(dwellStartedAt, 2000));
+	CHECK(WITHIN_ONE_RTI(sparkedAt, 2000 + TEST_DWELL));
+	CHECK(dwellOn == 0);
+
+	/* Retimed earlier before the dwell starts, to before the dwell was due */
+	startCase();
+	queueIgnitionEvent(TEST_COIL, 4000, 4000 + TEST_DWELL, 0);
+	retimeIgnitionEvent(TEST_COIL, 3500);
+	runUntil(10000);
+	printf("Moved earlier, dwell from %u to %u\n", dwellStartedAt, sparkedAt);
+	CHECK(WITHIN_ONE_RTI(dwellStartedAt, 1000 + RTI_PERIOD_TICKS));
+	CHECK(WITHIN_ONE_RTI(sparkedAt, 3500));
+	CHECK(dwellOn == 0);
+
+	/* Retimed later before the dwell starts */
+	startCase();
+	queueIgnitionEvent(TEST_COIL, 2000, 2000 + TEST_DWELL, 0);
+	retimeIgnitionEvent(TEST_COIL, 8000);
+	runUntil(12000);
+	printf("Moved later, dwell from %u to %u\n", dwellStartedAt, sparkedAt);
+	CHECK(WITHIN_ONE_RTI(dwellStartedAt, 8000 - TEST_DWELL));
+	CHECK(WITHIN_ONE_RTI(sparkedAt, 8000));
+
+	/* Retimed after the dwell has started, the spark moves alone */
+	startCase();
+	queueIgnitionEvent(TEST_COIL, 2000, 2000 + TEST_DWELL, 0);
+	runUntil(3000);
+	CHECK(dwellStartedAt != 0);
+	retimeIgnitionEvent(TEST_COIL, 4000);
+	runUntil(10000);
+	printf("Moved while dwelling, dwell from %u to %u\n", dwellStartedAt, sparkedAt);
+	CHECK(WITHIN_ONE_RTI(sparkedAt, 4000));
+	CHECK(dwellOn == 0);
+
+	/* The next cycle's dwell is already queued while this one dwells */
+	startCase();
+	queueIgnitionEvent(TEST_COIL, 2000, 2000 + TEST_DWELL, 0);
+	queueIgnitionEvent(TEST_COIL, 6000, 6000 + TEST_DWELL, 0);
+	runUntil(3000);
+	retimeIgnitionEvent(TEST_COIL, 4500);
+	CHECK(dwellQueueLength == 1);
+	CHECK(dwellQueue[0].time == 6000);
+	runUntil(5000);
+	printf("Next dwell queued, first dwell from %u to %u\n", dwellStartedAt, sparkedAt);
+	CHECK(WITHIN_ONE_RTI(sparkedAt, 4500));
+
+	/* Full queues drop the whole pair */
+	startCase();
+	unsigned char event;
+	for(event = 0;event < IGNITION_QUEUE_LENGTH;event++){
+		queueIgnitionEvent(TEST_COIL, 20000 + (event * 10), 30000 + (event * 10), 0);
+	}
+	queueIgnitionEvent(TEST_COIL, 1, 2, 0);
+	CHECK(Counters.ignitionEventsDropped == 1);
+	CHECK(dwellQueueLength == IGNITION_QUEUE_LENGTH);
+	CHECK(ignitionQueueLength == IGNITION_QUEUE_LENGTH);
+
+	printf("%u failures\n", failures);
+	return failures != 0;
+}
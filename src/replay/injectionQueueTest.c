@@ -0,0 +1,149 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file injectionQueueTest.c
+ *
+ * @brief Host test of the per channel injection queues
+ *
+ * Six pulses are scheduled on injector channel one, each from its own wheel
+ * event, before the first has opened. The first must be armed on the compare,
+ * the next four queued in order and the sixth dropped and counted. The channel
+ * ISR is then run through each open and close, and every close must arm the
+ * next queued start and its pulse width until the queue is empty and the
+ * channel disables itself. Last, a queued start that is already behind the
+ * close must open as soon as the code allows instead of a whole turn of the
+ * timer later, while one more than half a turn of the timer ahead must still
+ * wait for its time.
+ *
+ * Run by "make hosttests", exits non zero if any check fails.
+ *
+ * @author Fred Cooke
+ */
+
+
+#include "../inc/FreeMS2.h"
+#include "../inc/interrupts.h"
+#include "../inc/outputScheduler.h"
+#include "../inc/decoderInterface.h"
+
+
+#define TEST_TIME_STAMP 10000		/* The wheel event edge all six pulses are scheduled from */
+#define TEST_TOOTH_PERIOD 1000		/* So each two teeth of delay is 2000 ticks */
+#define TEST_PULSE_WIDTH 500		/* Plus the event number, so each pulse can be told apart */
+#define TEST_EVENTS 6
+
+
+/* The simulated register block that hostTarget.h points everything at */
+unsigned char hostRegisters[HOST_REGISTER_SPACE];
+
+
+static unsigned int failures;
+
+#define CHECK(condition)                                           \
+	if(!(condition)){                                              \
+		printf("Failed at line %d : %s\n", __LINE__, #condition);  \
+		failures++;                                                \
+	}
+
+
+/* Run the channel one ISR as its compare opens the injector */
+static void openInjector(){
+	PTIT |= 0x02;
+	TCNT = TC1 + 10;
+	Injector1ISR();
+}
+
+
+/* Run the channel one ISR as its compare closes the injector */
+static void closeInjector(unsigned short now){
+	PTIT &= ~0x02;
+	TCNT = now;
+	Injector1ISR();
+}
+
+
+int main(){
+	/* As init() would leave them */
+	injectorMainTimeRegisters[0] = TC1_ADDR;
+	injectorMainControlRegisters[0] = TCTL2_ADDR;
+	outputEventsRealtime = &outputEvents1;
+	masterPulseWidth = 10000;
+	predictedToothPeriod = TEST_TOOTH_PERIOD;
+
+	/* Event n starts 2n + 2 teeth after wheel event n, all from the same edge time */
+	unsigned char event;
+	for(event = 0;event < TEST_EVENTS;event++){
+		outputEvents1.events[event].wheelEvent = event;
+		outputEvents1.events[event].channel = 0;
+		outputEvents1.events[event].toothFraction = (event + 1) * 512;
+		outputEvents1.events[event].pulseWidth = TEST_PULSE_WIDTH + event;
+	}
+	outputEvents1.count = TEST_EVENTS;
+	for(event = 0;event < OUTPUT_EVENT_INDEX_LENGTH;event++){
+		outputEvents1.firstEvents[event] = (event < TEST_EVENTS) ? event : TEST_EVENTS;
+	}
+	for(event = 0;event < TEST_EVENTS;event++){
+		scheduleOutputEvents(event, TEST_TIME_STAMP);
+	}
+
+	/* One armed, a full queue behind it and one dropped */
+	CHECK(TC1 == TEST_TIME_STAMP + 2000);
+	CHECK((unsigned char)(injectionQueueTails[0] - injectionQueueHeads[0]) == INJECTION_QUEUE_LENGTH);
+	CHECK(Counters.injectionEventsDropped == 1);
+
+	/* Each close arms the next start, in order, with its own width */
+	unsigned short expectedStart = TEST_TIME_STAMP + 2000;
+	for(event = 0;event <= INJECTION_QUEUE_LENGTH;event++){
+		CHECK(TC1 == expectedStart);
+		openInjector();
+		CHECK(TC1 == expectedStart + TEST_PULSE_WIDTH + event);
+		closeInjector(TC1 + 20);
+		expectedStart += 2000;
+	}
+	CHECK(!(TIE & 0x02));
+	CHECK(injectionQueueHeads[0] == injectionQueueTails[0]);
+
+	/* A start already behind the close opens as soon as it can */
+	injectorMainEndTimes[0] = 0;
+	TCTL2 |= 0x0C;
+	injectionQueues[0][injectionQueueTails[0] & INJECTION_QUEUE_MASK].startTime = 30000;
+	injectionQueues[0][injectionQueueTails[0] & INJECTION_QUEUE_MASK].pulseWidth = 700;
+	injectionQueueTails[0]++;
+	closeInjector(30500);
+	CHECK(TC1 == 30500 + injectorSwitchOnCodeTime);
+	openInjector();
+	CHECK(injectorArmedPulseWidths[0] == 700);
+
+	/* A start far enough ahead to look behind in sixteen bits waits for its time */
+	injectionQueues[0][injectionQueueTails[0] & INJECTION_QUEUE_MASK].startTime = 31000 + 40000;
+	injectionQueues[0][injectionQueueTails[0] & INJECTION_QUEUE_MASK].pulseWidth = 800;
+	injectionQueueTails[0]++;
+	closeInjector(31000);
+	CHECK(TC1 == (unsigned short)(31000 + 40000));
+
+	printf("%u failures\n", failures);
+	return failures != 0;
+}
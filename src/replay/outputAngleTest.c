@@ -0,0 +1,105 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file outputAngleTest.c
+ *
+ * @brief Host test of the boot time output angle check for one decoder
+ *
+ * Built once for each decoder, like the replay harness. The decoder sets up its
+ * wheel from the shipped defaults and then the check from the end of
+ * initConfiguration is run. The defaults must pass, or the image would sit in
+ * the config error loop at boot. Two coils on the same angle must be refused
+ * only where the decoder resolves the whole engine cycle, as a shorter cycle
+ * fires outputs that fold together at once just as it always has. The same is
+ * then repeated with no cam sync and with a cam sync tooth, for decoders that
+ * use one.
+ *
+ * Run by "make hosttests", exits non zero if any check fails.
+ *
+ * @author Fred Cooke
+ */
+
+
+#include "../inc/FreeMS2.h"
+#include "../inc/interrupts.h"
+#include "../inc/outputScheduler.h"
+#include "../inc/decoderInterface.h"
+
+
+#define TEST_CRANK_ONLY 0xFF			/* camSyncTooth for no cam sync at all */
+#define TEST_CAM_SYNC_TOOTH 10
+
+
+/* The simulated register block that hostTarget.h points everything at */
+unsigned char hostRegisters[HOST_REGISTER_SPACE];
+
+
+static unsigned int failures;
+
+#define CHECK(condition)                                           \
+	if(!(condition)){                                              \
+		printf("Failed at line %d : %s\n", __LINE__, #condition);  \
+		failures++;                                                \
+	}
+
+
+/* Run the decoder setup and the angle check over the defaults and with one coil doubled up */
+static void checkAngles(const char* description){
+	volatile fixedConfig1* settings = (volatile fixedConfig1*)&fixedConfigs1;
+	unsigned short secondCoilAngle = settings->schedulingSettings.ignitionAngles[1];
+
+	decoderInitPreliminary();
+	unsigned char defaultCollisions = countCollidingOutputAngles();
+
+	settings->schedulingSettings.ignitionAngles[1] = settings->schedulingSettings.ignitionAngles[0];
+	unsigned char doubledCollisions = countCollidingOutputAngles();
+	settings->schedulingSettings.ignitionAngles[1] = secondCoilAngle;
+
+	printf("%s, output cycle %u, %u collisions by default and %u with a coil doubled up\n", description, outputCycleAngle, defaultCollisions, doubledCollisions);
+	CHECK(outputCycleAngle != 0);
+	CHECK(defaultCollisions == 0);
+	if(outputCycleAngle == ENGINE_CYCLE_ANGLE){
+		CHECK(doubledCollisions == 1);
+	}else{
+		CHECK(doubledCollisions == 0);
+	}
+}
+
+
+int main(){
+	volatile fixedConfig1* settings = (volatile fixedConfig1*)&fixedConfigs1;
+
+	checkAngles("Defaults");
+
+	settings->decoderSettings.camSyncTooth = TEST_CRANK_ONLY;
+	checkAngles("Crank only");
+
+	settings->decoderSettings.camSyncTooth = TEST_CAM_SYNC_TOOTH;
+	checkAngles("Cam sync tooth");
+
+	printf("%u failures\n", failures);
+	return failures != 0;
+}
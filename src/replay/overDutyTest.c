@@ -0,0 +1,159 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file overDutyTest.c
+ *
+ * @brief Host test of over duty injector pulses
+ *
+ * Two wheel events 60 degrees apart cover a 120 degree output cycle, which at
+ * 6000 RPM is 4166 ticks between pulses on a channel, so with the default
+ * maximumInjectorDuty anything over 3680 ticks is over duty. Channel one is
+ * given pulses either side of that. A pulse that fits must get its one event.
+ * An over duty pulse with no splits configured must get no events and have
+ * the channel held open by its compare with the interrupt off. With two splits
+ * it must get two half pulses half a cycle apart and be let go, unless even
+ * the whole pulse is longer than the cycle, when it must be held again. Losing
+ * RPM must let every held channel go.
+ *
+ * Run by "make hosttests", exits non zero if any check fails.
+ *
+ * @author Fred Cooke
+ */
+
+
+#include "../inc/FreeMS2.h"
+#include "../inc/interrupts.h"
+#include "../inc/outputScheduler.h"
+#include "../inc/decoderInterface.h"
+
+
+#define TEST_RPM 12000				/* 6000 RPM in RPM x 2 */
+
+
+/* The simulated register block that hostTarget.h points everything at */
+unsigned char hostRegisters[HOST_REGISTER_SPACE];
+
+
+static unsigned int failures;
+
+#define CHECK(condition)                                           \
+	if(!(condition)){                                              \
+		printf("Failed at line %d : %s\n", __LINE__, #condition);  \
+		failures++;                                                \
+	}
+
+
+/* Change a setting that is normally fixed in flash */
+static void setOverDutySplits(unsigned char splits){
+	volatile fixedConfig1* settings = (volatile fixedConfig1*)&fixedConfigs1;
+	settings->schedulingSettings.overDutySplits = splits;
+}
+
+
+/* Look for a channel's event in a wheel event's slice of the list, as the decoder would */
+static outputEvent* findEvent(unsigned char wheelEvent, unsigned char channel){
+	unsigned char index;
+	for(index = outputEvents0.firstEvents[wheelEvent];index < outputEvents0.firstEvents[wheelEvent + 1];index++){
+		if(outputEvents0.events[index].channel == channel){
+			return &outputEvents0.events[index];
+		}
+	}
+	return 0;
+}
+
+
+int main(){
+	/* As init() would leave them, channel one on its own compare and the rest sharing another */
+	injectorMainTimeRegisters[0] = TC1_ADDR;
+	injectorMainControlRegisters[0] = TCTL2_ADDR;
+	unsigned char channel;
+	for(channel = 1;channel < INJECTION_CHANNELS;channel++){
+		injectorMainTimeRegisters[channel] = TC2_ADDR;
+		injectorMainControlRegisters[channel] = TCTL2_ADDR;
+	}
+	outputEventsMath = &outputEvents0;
+	injectorMainPulseWidthsMath = injectorMainPulseWidths0;
+	CoreVars = &CoreVars0;
+	currentDwellMath = &currentDwell0;
+	currentDwellRealtime = &currentDwell0;
+
+	/* As a decoder would describe its wheel */
+	numberOfWheelEvents = 2;
+	wheelEventAngles[0] = 0;
+	wheelEventAngles[1] = 3000;
+	wheelEventCycleAngle = 6000;
+	outputCycleAngle = 6000;
+	toothPeriodAngle = 3000;
+	CoreVars->RPM = TEST_RPM;
+
+	/* Within duty, one event per channel */
+	setOverDutySplits(0);
+	injectorMainPulseWidths0[0] = 3000;
+	generateOutputEvents();
+	CHECK(outputEvents0.count == INJECTION_CHANNELS);
+	CHECK(outputEvents0.events[0].pulseWidth == 3000);
+
+	/* Over duty with no splits, held open */
+	injectorMainPulseWidths0[0] = 4000;
+	TIE = 0xFF;
+	generateOutputEvents();
+	printf("Held, %u events, held 0x%02X, TIE 0x%02X, TCTL2 0x%02X, CFORC 0x%02X\n", outputEvents0.count, injectorsHeldOpen, TIE, TCTL2, CFORC);
+	CHECK(outputEvents0.count == INJECTION_CHANNELS - 1);
+	CHECK(injectorsHeldOpen == 0x02);
+	CHECK(!(TIE & 0x02));
+	CHECK((TCTL2 & 0x0C) == 0x0C);
+	CHECK(CFORC == 0x02);
+
+	/* Over duty with two splits, half each half a cycle apart */
+	setOverDutySplits(2);
+	generateOutputEvents();
+	printf("Split, %u events, held 0x%02X, TCTL2 0x%02X\n", outputEvents0.count, injectorsHeldOpen, TCTL2);
+	CHECK(outputEvents0.count == INJECTION_CHANNELS + 1);
+	CHECK(injectorsHeldOpen == 0);
+	CHECK((TCTL2 & 0x0C) == 0);
+	CHECK(findEvent(0, 0) && (findEvent(0, 0)->pulseWidth == 2000));
+	CHECK(findEvent(1, 0) && (findEvent(1, 0)->pulseWidth == 2000));
+	CHECK(outputEvents0.firstEvents[0] == 0);
+	CHECK(outputEvents0.firstEvents[OUTPUT_EVENT_INDEX_LENGTH - 1] == outputEvents0.count);
+	for(channel = 1;channel < outputEvents0.count;channel++){
+		CHECK(outputEvents0.events[channel - 1].wheelEvent <= outputEvents0.events[channel].wheelEvent);
+	}
+
+	/* Longer than the cycle, no split can fit */
+	injectorMainPulseWidths0[0] = 5000;
+	generateOutputEvents();
+	CHECK(outputEvents0.count == INJECTION_CHANNELS - 1);
+	CHECK(injectorsHeldOpen == 0x02);
+
+	/* No RPM, nothing held */
+	CoreVars->RPM = 0;
+	generateOutputEvents();
+	CHECK(injectorsHeldOpen == 0);
+	CHECK((TCTL2 & 0x0C) == 0);
+
+	printf("%u failures\n", failures);
+	return failures != 0;
+}
@@ -0,0 +1,330 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file replay.c
+ *
+ * @brief Host replay harness for the decoder ISRs
+ *
+ * Builds on a normal Linux box against one decoder, exactly as it is compiled
+ * for the chip, plus the handful of files it depends on. See "make replay" and
+ * hostTarget.h for how the target only parts are replaced.
+ *
+ * Edges are read from a file or stdin, one per line :
+ *
+ * p|s time level [rpm]
+ *
+ * Where p or s picks the primary or secondary input, time is the extended time
+ * stamp of the edge in 0.8us ticks, level is the state of that input after the
+ * edge and the optional rpm is the true engine speed at that moment, used to
+ * check the RPM that the decoder and main loop between them would report.
+ * Lines starting with # are ignored.
+ *
+ * Each time a new tooth period is published the one predicted for it at the
+ * previous tooth is checked against it, and so is the previous period on its
+ * own. The difference is shown in degrees, which is how far an output
+ * scheduled a whole tooth after an edge would land from where it was meant to
+ * be, with and without the extrapolation.
+ *
+ * For each edge the timer registers and port T are set up as the hardware would
+ * leave them, the timer extension is brought up to date and the ISR is called.
+ * If the low word of the time stamp is inside the simulated latency the
+ * overflow is left pending, so that the time stamp fix up path gets exercised.
+ *
+ * Options :
+ *
+ * -v print the path taken and the state after every edge
+ * -l n simulated latency in ticks from edge to ISR start, default 20
+ *
+ * The wheel comes from the defaults in FixedConfig1.c, edit those and rebuild
+ * to try other patterns. Host times are a rough relative measure only.
+ *
+ * @author Fred Cooke
+ */
+
+
+#include "../inc/FreeMS2.h"
+#include "../inc/interrupts.h"
+#include "../inc/utils.h"
+#include "../inc/decoderInterface.h"
+
+
+/* Leading and trailing secondary edges to let the cam phase filter settle before it is measured */
+#define CAM_SETTLE_EDGES 20
+
+
+/* The simulated register block that hostTarget.h points everything at */
+unsigned char hostRegisters[HOST_REGISTER_SPACE];
+
+
+/* Everything worth knowing about one run */
+typedef struct {
+	unsigned int edges;
+	unsigned int primaryEdges;
+	unsigned int secondaryEdges;
+	unsigned int firstEdgeTime;
+	unsigned int syncEdge;					/* Zero until sync is first gained */
+	unsigned int syncTime;
+	unsigned int syncGains;
+	unsigned int pendingOverflows;
+	unsigned int RPMSamples;
+	double RPMErrorSum;
+	double RPMErrorMax;
+	unsigned int predictionSamples;
+	double heldErrorSum;					/* Angle errors if the last period is assumed to hold... */
+	double heldErrorMax;
+	double predictedErrorSum;				/* ...and with it extrapolated as the scheduler does */
+	double predictedErrorMax;
+	unsigned int camSamples[MAXIMUM_CAM_TEETH];	/* Filtered cam phases seen after the filter has settled */
+	double camPhaseSum[MAXIMUM_CAM_TEETH];
+	double camPhaseMin[MAXIMUM_CAM_TEETH];
+	double camPhaseMax[MAXIMUM_CAM_TEETH];
+	double primaryHostNanos;
+	double secondaryHostNanos;
+} replayResult;
+
+
+static double absolute(double value){
+	return (value < 0) ? -value : value;
+}
+
+
+static double hostNanos(){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec * 1e9) + now.tv_nsec;
+}
+
+
+/** Present one edge to the decoder
+ *
+ * Set up the capture register, port T, the overflow state and TCNT as they
+ * would be when the ISR starts, then call it.
+ */
+static void replayEdge(char input, unsigned int stamp, unsigned int level, unsigned int latency, replayResult* result){
+	static unsigned char portT = 0;
+	unsigned short lowWord = (unsigned short)stamp;
+
+	if(input == 'p'){
+		TC0 = lowWord;
+		portT = level ? (portT | 0x01) : (portT & 0xFE);
+	}else{
+		TC5 = lowWord;
+		portT = level ? (portT | 0x20) : (portT & 0xDF);
+	}
+	PTIT = portT;
+	TCNT = lowWord + latency;
+
+	/* Either the overflow ISR has already run or it is still pending behind this one */
+	if(lowWord < latency){
+		timerExtensionClock = (stamp >> 16) - 1;
+		TFLGOF = 0x80;
+		result->pendingOverflows++;
+	}else{
+		timerExtensionClock = stamp >> 16;
+		TFLGOF = 0;
+	}
+
+	double start = hostNanos();
+	if(input == 'p'){
+		PrimaryRPMISR();
+		result->primaryHostNanos += hostNanos() - start;
+		result->primaryEdges++;
+	}else{
+		SecondaryRPMISR();
+		result->secondaryHostNanos += hostNanos() - start;
+		result->secondaryEdges++;
+	}
+}
+
+
+/** Name the path the ISR took from what changed */
+static const char* pathTaken(unsigned short noiseBefore, unsigned short crankLossesBefore, unsigned short camLossesBefore, unsigned short statusBefore){
+	if(Counters.primaryNoiseEdgesRejected != noiseBefore){
+		return "noise";
+	}else if(Counters.crankSyncLosses != crankLossesBefore){
+		return "crank sync lost";
+	}else if(Counters.camSyncLosses != camLossesBefore){
+		return "cam sync lost";
+	}else if(!(statusBefore & PRIMARY_SYNC) && (coreStatusA & PRIMARY_SYNC)){
+		return "sync gained";
+	}else if(coreStatusA & PRIMARY_SYNC){
+		return "synced";
+	}else{
+		return "searching";
+	}
+}
+
+
+int main(int argc, char* argv[]){
+	unsigned int verbose = 0;
+	unsigned int latency = 20;
+	FILE* input = stdin;
+
+	int arg;
+	for(arg = 1;arg < argc;arg++){
+		if(!strcmp(argv[arg], "-v")){
+			verbose = 1;
+		}else if(!strcmp(argv[arg], "-l") && ((arg + 1) < argc)){
+			latency = atoi(argv[++arg]);
+		}else if(!(input = fopen(argv[arg], "r"))){
+			fprintf(stderr, "Can't open %s\n", argv[arg]);
+			return 1;
+		}
+	}
+
+	/* The parts of init that the decoders rely on */
+	outputEventsMath = &outputEvents0;
+	outputEventsRealtime = &outputEvents1;
+	currentDwellMath = &currentDwell0;
+	currentDwellRealtime = &currentDwell1;
+	ADCArrays = &ADCArrays0;
+	ADCArraysRecord = &ADCArrays1;
+	mathSampleTimeStampRecord = &ISRLatencyVars.mathSampleTimeStamp1;
+	decoderInitPreliminary();
+
+	replayResult result;
+	memset(&result, 0, sizeof(result));
+
+	char line[128];
+	while(fgets(line, sizeof(line), input)){
+		char which;
+		unsigned int stamp;
+		unsigned int level;
+		double trueRPM;
+		int fields = sscanf(line, " %c %u %u %lf", &which, &stamp, &level, &trueRPM);
+		if((fields < 3) || (which == '#') || ((which != 'p') && (which != 's'))){
+			continue;
+		}
+
+		if(result.edges == 0){
+			result.firstEdgeTime = stamp;
+		}
+		result.edges++;
+
+		unsigned short noiseBefore = Counters.primaryNoiseEdgesRejected;
+		unsigned short crankLossesBefore = Counters.crankSyncLosses;
+		unsigned short camLossesBefore = Counters.camSyncLosses;
+		unsigned short statusBefore = coreStatusA;
+		unsigned long heldBefore = latestToothPeriod;
+		unsigned long predictedBefore = predictedToothPeriod;
+
+		replayEdge(which, stamp, level, latency, &result);
+
+		const char* path = pathTaken(noiseBefore, crankLossesBefore, camLossesBefore, statusBefore);
+		if(!(statusBefore & PRIMARY_SYNC) && (coreStatusA & PRIMARY_SYNC)){
+			result.syncGains++;
+			if(result.syncEdge == 0){
+				result.syncEdge = result.edges;
+				result.syncTime = stamp - result.firstEdgeTime;
+			}
+		}
+
+		/* Exactly what the main loop would report and feed back */
+		unsigned short RPM = periodToRPM(RPMDividend, toothPeriodSum);
+		primaryNoiseWindow = periodToNoiseWindow(toothPeriodSum);
+		if((fields == 4) && (which == 'p') && (coreStatusA & PRIMARY_SYNC)){
+			double error = (RPM / 2.0) - trueRPM;
+			if(error < 0){
+				error = -error;
+			}
+			result.RPMErrorSum += error;
+			if(error > result.RPMErrorMax){
+				result.RPMErrorMax = error;
+			}
+			result.RPMSamples++;
+		}
+
+		/* Only where the period moved, identical periods are no error either way */
+		unsigned char published = (latestToothPeriod != heldBefore) || (predictedToothPeriod != predictedBefore);
+		if(published && heldBefore && (statusBefore & PRIMARY_SYNC) && (coreStatusA & PRIMARY_SYNC)){
+			double degreesPerTick = (toothPeriodAngle / (double)ANGLE_FACTOR) / latestToothPeriod;
+			double heldError = absolute((double)heldBefore - latestToothPeriod) * degreesPerTick;
+			double predictedError = absolute((double)predictedBefore - latestToothPeriod) * degreesPerTick;
+			result.heldErrorSum += heldError;
+			result.predictedErrorSum += predictedError;
+			if(heldError > result.heldErrorMax){
+				result.heldErrorMax = heldError;
+			}
+			if(predictedError > result.predictedErrorMax){
+				result.predictedErrorMax = predictedError;
+			}
+			result.predictionSamples++;
+		}
+
+		/* The main loop runs far more often than cam edges arrive, so convert each as it comes */
+		unsigned char captured = camEdgesCaptured;
+		camEdgesToPhases();
+		unsigned char tooth;
+		for(tooth = 0;tooth < MAXIMUM_CAM_TEETH;tooth++){
+			if((captured & (1 << tooth)) && (Counters.secondaryTeethSeen > CAM_SETTLE_EDGES)){
+				double phase = camToothPhases[tooth] / (double)ANGLE_FACTOR;
+				if((result.camSamples[tooth] == 0) || (phase < result.camPhaseMin[tooth])){
+					result.camPhaseMin[tooth] = phase;
+				}
+				if((result.camSamples[tooth] == 0) || (phase > result.camPhaseMax[tooth])){
+					result.camPhaseMax[tooth] = phase;
+				}
+				result.camPhaseSum[tooth] += phase;
+				result.camSamples[tooth]++;
+			}
+		}
+
+		if(verbose){
+			printf("%8u %c %10u %u %-16s event %3u RPM %7.1f\n", result.edges, which, stamp, level, path, currentWheelEvent, RPM / 2.0);
+		}
+	}
+
+	printf("Edges              : %u primary, %u secondary\n", result.primaryEdges, result.secondaryEdges);
+	if(result.syncEdge){
+		printf("Time to sync       : %u edges, %.3f ms, %.1f degrees from the first tooth\n", result.syncEdge, result.syncTime * 0.0008, firstSyncAngle() / (double)ANGLE_FACTOR);
+	}else{
+		printf("Time to sync       : never\n");
+	}
+	printf("Sync gains/losses  : %u gained, %u crank lost, %u cam lost\n", result.syncGains, Counters.crankSyncLosses, Counters.camSyncLosses);
+	printf("Noise rejected     : %u\n", Counters.primaryNoiseEdgesRejected);
+	printf("Pending overflows  : %u\n", result.pendingOverflows);
+	if(result.RPMSamples){
+		printf("RPM error          : %.2f mean, %.2f max over %u synced teeth\n", result.RPMErrorSum / result.RPMSamples, result.RPMErrorMax, result.RPMSamples);
+	}
+	if(result.predictionSamples){
+		printf("Tooth ahead, held  : %.3f mean, %.3f max degrees over %u changing teeth\n", result.heldErrorSum / result.predictionSamples, result.heldErrorMax, result.predictionSamples);
+		printf("Tooth ahead, extrap: %.3f mean, %.3f max degrees\n", result.predictedErrorSum / result.predictionSamples, result.predictedErrorMax);
+	}
+	unsigned char tooth;
+	for(tooth = 0;tooth < MAXIMUM_CAM_TEETH;tooth++){
+		if(result.camSamples[tooth]){
+			printf("Cam tooth %u phase  : %.2f mean, %.2f to %.2f degrees after event 0 over %u edges\n", tooth, result.camPhaseSum[tooth] / result.camSamples[tooth], result.camPhaseMin[tooth], result.camPhaseMax[tooth], result.camSamples[tooth]);
+		}
+	}
+	if(result.primaryEdges){
+		printf("Primary ISR host   : %.0f ns average\n", result.primaryHostNanos / result.primaryEdges);
+	}
+	if(result.secondaryEdges){
+		printf("Secondary ISR host : %.0f ns average\n", result.secondaryHostNanos / result.secondaryEdges);
+	}
+
+	return 0;
+}
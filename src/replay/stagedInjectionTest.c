@@ -0,0 +1,191 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file stagedInjectionTest.c
+ *
+ * @brief Host test of the staged injector starts and ends
+ *
+ * A main pulse with a shorter staged pulse is run through injector channel one
+ * and the RTI in each of the four combinations of fixed and scheduled staged
+ * start and end. A fixed start opens the staged injector with the main one and
+ * a scheduled start opens it such that it would close with the main one. A
+ * fixed end closes it with the main one and a scheduled end holds it for its
+ * own width. Scheduled switchings are carried out by the RTI, so they may land
+ * up to one RTI period late. Last, a staged pulse too short to start before a
+ * fixed end must never open the staged injector or leave anything pending. And
+ * with room for only part of a pulse's switchings none of them may happen, as
+ * a start without its end would hold the staged injector open.
+ *
+ * Run by "make hosttests", exits non zero if any check fails.
+ *
+ * @author Fred Cooke
+ */
+
+
+#include "../inc/FreeMS2.h"
+#include "../inc/interrupts.h"
+#include "../inc/injectionISRs.h"
+
+
+#define TEST_START 1000					/* When the main injector opens */
+#define TEST_MAIN_WIDTH 5000
+#define TEST_STAGED_WIDTH 2000
+#define TEST_LENGTH 40000				/* How long to run the RTI for after the main injector opens */
+
+
+/* The simulated register block that hostTarget.h points everything at */
+unsigned char hostRegisters[HOST_REGISTER_SPACE];
+
+
+static unsigned int failures;
+
+#define CHECK(condition)                                           \
+	if(!(condition)){                                              \
+		printf("Failed at line %d : %s\n", __LINE__, #condition);  \
+		failures++;                                                \
+	}
+
+/* True if time is at or up to one RTI period after when */
+#define WITHIN_ONE_RTI(time, when) ((unsigned short)((time) - (when)) < RTI_PERIOD_TICKS)
+
+
+/* Pick fixed or scheduled staged starts and ends */
+static void setStagedMode(unsigned short fixedBits){
+	volatile fixedConfig1* settings = (volatile fixedConfig1*)&fixedConfigs1;
+	settings->coreSettingsA = (settings->coreSettingsA & ~(STAGED_START | STAGED_END)) | fixedBits;
+}
+
+
+/* Open the main injector at start, close it mainWidth later and run the RTI throughout, noting when the staged one switched */
+static void runPulse(unsigned short mainWidth, unsigned short stagedWidth, unsigned short* stagedOnAt, unsigned short* stagedOffAt){
+	injectorArmedPulseWidths[0] = mainWidth;
+	injectorStagedPulseWidths1[0] = stagedWidth;
+	*stagedOnAt = 0;
+	*stagedOffAt = 0;
+
+	TC1 = TEST_START;
+	PTIT |= 0x02;
+	TCNT = TEST_START + 10;
+	Injector1ISR();
+
+	unsigned char wasOn = PORTK & STAGED1ON;
+	if(wasOn){
+		*stagedOnAt = TEST_START;
+	}
+
+	unsigned char mainClosed = FALSE;
+	unsigned short now;
+	for(now = TEST_START + RTI_PERIOD_TICKS;(unsigned short)(now - TEST_START) < TEST_LENGTH;now += RTI_PERIOD_TICKS){
+		TCNT = now;
+		if(!mainClosed && !((unsigned short)(now - (TEST_START + mainWidth)) & 0x8000)){
+			PTIT &= ~0x02;
+			Injector1ISR();
+			mainClosed = TRUE;
+		}
+		RTIISR();
+
+		unsigned char isOn = PORTK & STAGED1ON;
+		if(isOn && !wasOn){
+			*stagedOnAt = now;
+		}
+		if(!isOn && wasOn){
+			*stagedOffAt = now;
+		}
+		wasOn = isOn;
+	}
+}
+
+
+int main(){
+	/* As init() would leave them */
+	injectorMainTimeRegisters[0] = TC1_ADDR;
+	injectorMainControlRegisters[0] = TCTL2_ADDR;
+	injectorStagedPulseWidthsRealtime = injectorStagedPulseWidths1;
+	coreStatusA |= STAGED_REQUIRED;
+
+	unsigned short on;
+	unsigned short off;
+
+	setStagedMode(STAGED_START | STAGED_END);
+	runPulse(TEST_MAIN_WIDTH, TEST_STAGED_WIDTH, &on, &off);
+	printf("Fixed start and end, on at %u and off at %u\n", on, off);
+	CHECK(on == TEST_START);
+	CHECK(WITHIN_ONE_RTI(off, TEST_START + TEST_MAIN_WIDTH));
+
+	setStagedMode(STAGED_START);
+	runPulse(TEST_MAIN_WIDTH, TEST_STAGED_WIDTH, &on, &off);
+	printf("Fixed start and scheduled end, on at %u and off at %u\n", on, off);
+	CHECK(on == TEST_START);
+	CHECK(WITHIN_ONE_RTI(off, TEST_START + TEST_STAGED_WIDTH));
+
+	setStagedMode(STAGED_END);
+	runPulse(TEST_MAIN_WIDTH, TEST_STAGED_WIDTH, &on, &off);
+	printf("Scheduled start and fixed end, on at %u and off at %u\n", on, off);
+	CHECK(WITHIN_ONE_RTI(on, TEST_START + TEST_MAIN_WIDTH - TEST_STAGED_WIDTH));
+	CHECK(WITHIN_ONE_RTI(off, TEST_START + TEST_MAIN_WIDTH));
+
+	setStagedMode(0);
+	runPulse(TEST_MAIN_WIDTH, TEST_STAGED_WIDTH, &on, &off);
+	printf("Scheduled start and end, on at %u and off at %u\n", on, off);
+	CHECK(WITHIN_ONE_RTI(on, TEST_START + TEST_MAIN_WIDTH - TEST_STAGED_WIDTH));
+	CHECK(WITHIN_ONE_RTI(off, TEST_START + TEST_MAIN_WIDTH));
+
+	/* Due after the main injector has closed, so the fixed end must cancel it */
+	setStagedMode(STAGED_END);
+	runPulse(TEST_MAIN_WIDTH, 30, &on, &off);
+	printf("Short scheduled start and fixed end, on at %u and off at %u\n", on, off);
+	CHECK(!(PORTK & STAGED1ON));
+	CHECK(stagedEventsPending == 0);
+
+	/* Room for one of two switchings, so neither and a drop counted */
+	unsigned char slot;
+	for(slot = 1;slot < STAGED_EVENT_SLOTS;slot++){
+		stagedEvents[slot].time = 0x10000000;
+		stagedEvents[slot].channelMask = STAGED2ON;
+		stagedEventsPending++;
+	}
+	unsigned short dropped = Counters.stagedEventsDropped;
+	setStagedMode(0);
+	runPulse(TEST_MAIN_WIDTH, TEST_STAGED_WIDTH, &on, &off);
+	printf("Scheduled start and end with one slot, on at %u and off at %u\n", on, off);
+	CHECK(on == 0);
+	CHECK(Counters.stagedEventsDropped == dropped + 1);
+	CHECK(stagedEventsPending == STAGED_EVENT_SLOTS - 1);
+
+	/* No room for the end, so a fixed start mustn't open it either */
+	stagedEvents[0].time = 0x10000000;
+	stagedEvents[0].channelMask = STAGED2ON;
+	stagedEventsPending++;
+	setStagedMode(STAGED_START);
+	runPulse(TEST_MAIN_WIDTH, TEST_STAGED_WIDTH, &on, &off);
+	printf("Fixed start and scheduled end with no slots, on at %u and off at %u\n", on, off);
+	CHECK(on == 0);
+	CHECK(!(PORTK & STAGED1ON));
+	CHECK(Counters.stagedEventsDropped == dropped + 2);
+
+	printf("%u failures\n", failures);
+	return failures != 0;
+}
@@ -0,0 +1,125 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file timeStampTest.c
+ *
+ * @brief Host test of EXTEND_TIME_STAMP against every overflow ordering
+ *
+ * Every capture low word is paired with every delay below 0x8000 ticks from
+ * the capture to the read of TFLGOF, and with every state the timer overflow
+ * can be in at that read. If the last wrap came after the capture the overflow
+ * is still pending, as every timer channel outranks it. If it came before the
+ * capture TimerOverflow may or may not have run yet, unless the wrap is 0x8000
+ * or more ticks old, in which case it has. That is 2,684,370,944 cases, and
+ * each must give the high word of the tick the capture was taken on.
+ *
+ * Captures are given the high word zero, so an overflow still pending from
+ * before the capture leaves timerExtensionClock at 0xFFFF and the increment
+ * has to wrap.
+ *
+ * Run by "make hosttests", exits non zero on any wrong time stamp or if any of
+ * the orderings was never reached.
+ *
+ * @author Fred Cooke
+ */
+
+
+#include "../inc/FreeMS2.h"
+#include "../inc/interrupts.h"
+
+
+/* The simulated register block that hostTarget.h points everything at */
+unsigned char hostRegisters[HOST_REGISTER_SPACE];
+
+
+/* Where the last wrap was relative to the capture and whether it had been serviced at the read */
+enum {
+	WRAP_BEFORE_SERVICED,
+	WRAP_BEFORE_PENDING,
+	WRAP_AFTER_PENDING,
+	ORDERINGS
+};
+
+static const char* orderingNames[ORDERINGS] = {
+	"wrap before capture, serviced",
+	"wrap before capture, pending",
+	"wrap after capture, pending"
+};
+
+static unsigned int cases[ORDERINGS];
+static unsigned int failures;
+
+
+/* Extend one capture as the ISRs do with the overflow state given and check the result */
+static void check(unsigned short capture, unsigned short clock, unsigned char flag, unsigned short delay, unsigned char ordering){
+	LongTime timeStamp;
+	timerExtensionClock = clock;
+	TFLGOF = flag;
+
+	EXTEND_TIME_STAMP(timeStamp, capture);
+
+	cases[ordering]++;
+	if((timeStamp.timeShorts[0] != 0) || (timeStamp.timeShorts[1] != capture)){
+		if(failures < 10){
+			printf("Capture 0x%04X read after %u ticks with %s gave 0x%08X\n", capture, delay, orderingNames[ordering], timeStamp.timeLong);
+		}
+		failures++;
+	}
+}
+
+
+int main(){
+	unsigned int capture;
+	unsigned int delay;
+	for(capture = 0;capture < 0x10000;capture++){
+		for(delay = 0;delay < 0x8000;delay++){
+			/* Ticks since the wrap into high word zero when TFLGOF is read */
+			unsigned int readTime = capture + delay;
+			if(readTime > 0xFFFF){
+				/* The wrap into high word zero is long serviced and the next one is pending */
+				check(capture, 0, 0x80, delay, WRAP_AFTER_PENDING);
+			}else{
+				check(capture, 0, 0, delay, WRAP_BEFORE_SERVICED);
+				if(readTime < 0x8000){
+					check(capture, 0xFFFF, 0x80, delay, WRAP_BEFORE_PENDING);
+				}
+			}
+		}
+	}
+
+	unsigned int total = 0;
+	unsigned char ordering;
+	for(ordering = 0;ordering < ORDERINGS;ordering++){
+		printf("%10u cases with %s\n", cases[ordering], orderingNames[ordering]);
+		total += cases[ordering];
+		if(cases[ordering] == 0){
+			failures++;
+		}
+	}
+	printf("%10u cases, %u wrong\n", total, failures);
+
+	return failures != 0;
+}
@@ -0,0 +1,333 @@
+/* FreeMS2 - the open source engine management system
+ *
+ * Copyright 2008, 2009, 2010 Fred Cooke
+ *
+ * This file is part of the FreeMS2 project.
+ *
+ * FreeMS2 software is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeMS2 software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with any FreeMS2 software.  If not, see http://www.gnu.org/licenses/
+ *
+ * We ask that if you make any changes to this file you email them upstream to
+ * us at admin(at)diyefi(dot)org or, even better, fork the code on github.com!
+ *
+ * Thank you for choosing FreeMS2 to run your engine!
+ */
+
+
+/**	@file wheelGenerator.c
+ *
+ * @brief Synthetic crank and cam edge streams for the replay harness
+ *
+ * Turns a wheel description and a speed profile into the edge stream format
+ * that replay.c reads, in the 0.8us ticks that the firmware uses, with the true
+ * RPM at each edge in the last column. Engine angle is integrated in small
+ * steps so RPM ramps and cranking stutter land on the teeth as they would on a
+ * real engine rather than being applied per tooth.
+ *
+ * Wheels :
+ *
+ * -w 36-1, 60-2, 36-2-2-2, nd24 or nbmiata, default 36-1
+ * -t teeth -m missing -g gap,gap,... any other missing teeth crank wheel
+ * -b tooth:degrees moves one primary tooth, a bent or badly machined wheel
+ * -p degrees moves every cam tooth, variable valve timing or a slipped belt
+ *
+ * The crank wheels have a single cam tooth per cycle. The 36-2-2-2 gaps and the
+ * NB Miata tooth angles are approximations good enough for decoder work, not
+ * measurements. The nd24 wheel matches the NipponDenso decoder, twelve evenly
+ * spaced teeth per secondary pulse and two of those per cycle.
+ *
+ * Profile :
+ *
+ * -r start:end RPM ramped linearly with angle over the run, default 1000:1000
+ * -c cycles to generate, default 10
+ * -s stutter, peak fraction of RPM lost and regained per compression, 0 to 1
+ * -n cylinders, sets the stutter frequency, default 4
+ * -j jitter, maximum random error added to each edge in ticks
+ * -e noise, chance per primary edge of a narrow extra pulse just after it, 0 to 1
+ * -d seed for the random parts, default 1
+ *
+ * @author Fred Cooke
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+#define CYCLE_DEGREES 720.0
+#define TICKS_PER_SECOND 1250000.0		/* 0.8us ticks */
+#define STEP_DEGREES 0.05				/* Integration step */
+#define MAXIMUM_TEETH 128
+#define NOISE_WIDTH_TICKS 6				/* Roughly the width of a spike through the VR conditioner */
+
+
+/* Tooth angles in engine cycle degrees for both inputs and how wide each tooth is */
+typedef struct {
+	unsigned int primaryCount;
+	double primaryAngles[MAXIMUM_TEETH];
+	unsigned int secondaryCount;
+	double secondaryAngles[MAXIMUM_TEETH];
+	double primaryWidth;
+	double secondaryWidth;
+	unsigned int primaryRevolutions;	/* 2 for a crank wheel, 1 for a cam or distributor wheel */
+} wheel;
+
+
+/* The run as configured on the command line */
+typedef struct {
+	double startRPM;
+	double endRPM;
+	unsigned int cycles;
+	double stutter;
+	unsigned int cylinders;
+	unsigned int jitter;
+	double noise;
+} profile;
+
+
+/* Where the integration has got to */
+static double currentAngle = 0;
+static double currentTicks = 1000;
+
+
+/** Crank wheel with groups of teeth missing, on the crank so it turns twice per cycle */
+static void missingTeethWheel(wheel* w, unsigned int teeth, unsigned int missing, unsigned int* gaps, unsigned int gapCount){
+	double slot = 360.0 / teeth;
+	unsigned int revolution;
+	w->primaryCount = 0;
+	for(revolution = 0;revolution < 2;revolution++){
+		unsigned int tooth;
+		for(tooth = 0;tooth < teeth;tooth++){
+			unsigned int gap;
+			unsigned int present = 1;
+			for(gap = 0;gap < gapCount;gap++){
+				if((tooth >= gaps[gap]) && (tooth < (gaps[gap] + missing))){
+					present = 0;
+				}
+			}
+			if(present && (w->primaryCount < MAXIMUM_TEETH)){
+				w->primaryAngles[w->primaryCount] = (revolution * 360.0) + (tooth * slot);
+				w->primaryCount++;
+			}
+		}
+	}
+	w->primaryWidth = slot / 2;
+	w->primaryRevolutions = 2;
+	w->secondaryCount = 1;
+	w->secondaryAngles[0] = 90.0;
+	w->secondaryWidth = 20.0;
+}
+
+
+/** Fill in a wheel from its name, zero if the name isn't known */
+static int namedWheel(wheel* w, const char* name){
+	if(!strcmp(name, "36-1")){
+		unsigned int gaps[] = {35};
+		missingTeethWheel(w, 36, 1, gaps, 1);
+	}else if(!strcmp(name, "60-2")){
+		unsigned int gaps[] = {58};
+		missingTeethWheel(w, 60, 2, gaps, 1);
+	}else if(!strcmp(name, "36-2-2-2")){
+		unsigned int gaps[] = {0, 4, 18};
+		missingTeethWheel(w, 36, 2, gaps, 3);
+	}else if(!strcmp(name, "nd24")){
+		unsigned int tooth;
+		w->primaryCount = 24;
+		for(tooth = 0;tooth < 24;tooth++){
+			w->primaryAngles[tooth] = tooth * 30.0;
+		}
+		w->primaryWidth = 15.0;
+		w->primaryRevolutions = 1;
+		w->secondaryCount = 2;
+		w->secondaryAngles[0] = 345.0;
+		w->secondaryAngles[1] = 705.0;
+		w->secondaryWidth = 7.5;
+	}else if(!strcmp(name, "nbmiata")){
+		double crank[] = {0, 70, 180, 250, 360, 430, 540, 610};
+		double cam[] = {100, 280, 300, 570};
+		w->primaryCount = 8;
+		memcpy(w->primaryAngles, crank, sizeof(crank));
+		w->primaryWidth = 10.0;
+		w->primaryRevolutions = 2;
+		w->secondaryCount = 4;
+		memcpy(w->secondaryAngles, cam, sizeof(cam));
+		w->secondaryWidth = 10.0;
+	}else{
+		return 0;
+	}
+	return 1;
+}
+
+
+/** Instantaneous RPM at an absolute angle into the run */
+static double RPMAt(const profile* p, double angle){
+	double totalAngle = p->cycles * CYCLE_DEGREES;
+	double RPM = p->startRPM + ((p->endRPM - p->startRPM) * (angle / totalAngle));
+
+	/* Compressions per crank revolution is half the cylinder count on a four stroke */
+	double compressionPhase = (angle / 360.0) * (p->cylinders / 2.0) * 2.0 * M_PI;
+	RPM *= 1.0 - (p->stutter * 0.5 * (1.0 - cos(compressionPhase)));
+
+	/* Don't let a silly profile stop the engine dead */
+	if(RPM < 1.0){
+		RPM = 1.0;
+	}
+	return RPM;
+}
+
+
+/** Integrate forward to an angle, returning the time in ticks when it is reached */
+static double ticksAt(const profile* p, double angle){
+	while(currentAngle < angle){
+		double step = angle - currentAngle;
+		if(step > STEP_DEGREES){
+			step = STEP_DEGREES;
+		}
+		double degreesPerTick = (RPMAt(p, currentAngle + (step / 2)) * 360.0) / (60.0 * TICKS_PER_SECOND);
+		currentTicks += step / degreesPerTick;
+		currentAngle += step;
+	}
+	return currentTicks;
+}
+
+
+/* One edge waiting to be written */
+typedef struct {
+	double angle;
+	char input;
+	unsigned int level;
+} edge;
+
+
+static int compareEdges(const void* a, const void* b){
+	double difference = ((const edge*)a)->angle - ((const edge*)b)->angle;
+	return (difference > 0) - (difference < 0);
+}
+
+
+static void printEdge(char input, double ticks, unsigned int level, double RPM, unsigned int jitter){
+	if(jitter){
+		ticks += (rand() % ((2 * jitter) + 1)) - (double)jitter;
+	}
+	printf("%c %u %u %.1f\n", input, (unsigned int)(unsigned long long)ticks, level, RPM);
+}
+
+
+int main(int argc, char* argv[]){
+	wheel w;
+	profile p = {1000, 1000, 10, 0, 4, 0, 0};
+	unsigned int seed = 1;
+	unsigned int teeth = 0;
+	unsigned int missing = 1;
+	unsigned int gaps[MAXIMUM_TEETH] = {0};
+	unsigned int gapCount = 0;
+	unsigned int bentTooth = 0;
+	double bentDegrees = 0;
+	double camDegrees = 0;
+	namedWheel(&w, "36-1");
+
+	int arg;
+	for(arg = 1;(arg + 1) < argc;arg += 2){
+		const char* value = argv[arg + 1];
+		switch(argv[arg][1]){
+			case 'w':
+				if(!namedWheel(&w, value)){
+					fprintf(stderr, "Unknown wheel %s\n", value);
+					return 1;
+				}
+				break;
+			case 't': teeth = atoi(value); break;
+			case 'm': missing = atoi(value); break;
+			case 'g':
+			{
+				char* list = strdup(value);
+				char* token;
+				for(token = strtok(list, ",");token && (gapCount < MAXIMUM_TEETH);token = strtok(NULL, ",")){
+					gaps[gapCount++] = atoi(token);
+				}
+				free(list);
+				break;
+			}
+			case 'b': sscanf(value, "%u:%lf", &bentTooth, &bentDegrees); break;
+			case 'p': camDegrees = atof(value); break;
+			case 'r': sscanf(value, "%lf:%lf", &p.startRPM, &p.endRPM); break;
+			case 'c': p.cycles = atoi(value); break;
+			case 's': p.stutter = atof(value); break;
+			case 'n': p.cylinders = atoi(value); break;
+			case 'j': p.jitter = atoi(value); break;
+			case 'e': p.noise = atof(value); break;
+			case 'd': seed = atoi(value); break;
+			default:
+				fprintf(stderr, "Unknown option %s, see the top of wheelGenerator.c\n", argv[arg]);
+				return 1;
+		}
+	}
+	if(teeth){
+		if(gapCount == 0){
+			gaps[0] = teeth - missing;
+			gapCount = 1;
+		}
+		missingTeethWheel(&w, teeth, missing, gaps, gapCount);
+	}
+	/* A crank wheel passes the same bent tooth every revolution */
+	unsigned int teethPerRevolution = w.primaryCount / w.primaryRevolutions;
+	if(bentTooth < teethPerRevolution){
+		unsigned int revolution;
+		for(revolution = 0;revolution < w.primaryRevolutions;revolution++){
+			w.primaryAngles[bentTooth + (revolution * teethPerRevolution)] += bentDegrees;
+		}
+	}
+	srand(seed);
+
+	/* Every edge of one cycle in angle order, then repeated for each cycle */
+	static edge edges[4 * MAXIMUM_TEETH];
+	unsigned int count = 0;
+	unsigned int tooth;
+	for(tooth = 0;tooth < w.primaryCount;tooth++){
+		edge rising = {w.primaryAngles[tooth], 'p', 1};
+		edge falling = {w.primaryAngles[tooth] + w.primaryWidth, 'p', 0};
+		edges[count++] = rising;
+		edges[count++] = falling;
+	}
+	for(tooth = 0;tooth < w.secondaryCount;tooth++){
+		double angle = fmod(w.secondaryAngles[tooth] + camDegrees + CYCLE_DEGREES, CYCLE_DEGREES);
+		edge rising = {angle, 's', 1};
+		edge falling = {angle + w.secondaryWidth, 's', 0};
+		edges[count++] = rising;
+		edges[count++] = falling;
+	}
+	qsort(edges, count, sizeof(edge), compareEdges);
+
+	printf("# %u primary and %u secondary teeth per cycle, %u cycles from %.0f to %.0f RPM\n", w.primaryCount, w.secondaryCount, p.cycles, p.startRPM, p.endRPM);
+
+	unsigned int cycle;
+	for(cycle = 0;cycle < p.cycles;cycle++){
+		unsigned int index;
+		for(index = 0;index < count;index++){
+			double angle = (cycle * CYCLE_DEGREES) + edges[index].angle;
+			double ticks = ticksAt(&p, angle);
+			double RPM = RPMAt(&p, angle);
+			printEdge(edges[index].input, ticks, edges[index].level, RPM, p.jitter);
+
+			/* A spike just after a primary edge, back to the level the edge left after */
+			if((edges[index].input == 'p') && (p.noise > 0) && ((rand() / (double)RAND_MAX) < p.noise)){
+				printEdge('p', ticks + NOISE_WIDTH_TICKS, !edges[index].level, RPM, 0);
+				printEdge('p', ticks + (2 * NOISE_WIDTH_TICKS), edges[index].level, RPM, 0);
+			}
+		}
+	}
+
+	return 0;
+}
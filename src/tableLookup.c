@@ -221,6 +221,10 @@ unsigned short lookupTwoDTableUS(twoDTableUS * Table, unsigned short Value){
 		}
 	}
 
+	/* Off either end of the table, hold the end value rather than divide by zero */
+	if(highAxisValue == lowAxisValue){
+		return lowLookupValue;
+	}
 
 	/* Interpolate and return the value */
 	return lowLookupValue + (((signed long)((signed long)highLookupValue - lowLookupValue) * (Value - lowAxisValue))/ (highAxisValue - lowAxisValue));
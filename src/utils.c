@@ -38,8 +38,11 @@
 
 #define UTILS_C
 #include "inc/FreeMS2.h"
+#include "inc/interrupts.h"
 #include "inc/commsISRs.h"
+#include "inc/ignitionISRs.h"
 #include "inc/utils.h"
+#include "inc/decoderInterface.h"
 #include <string.h>
 
 
@@ -140,6 +143,183 @@ unsigned short safeScale(unsigned short baseValue, unsigned short scaler){
 //}
 
 
+/** @brief Convert tooth periods to RPM
+ *
+ * The one and only place that tooth timing is divided into RPM. Decoders
+ * publish raw periods from their ISRs and this is called from the main loop,
+ * which keeps the 32 bit divide out of interrupt context entirely.
+ *
+ * @author Fred Cooke
+ *
+ * @param dividend the decoder specific RPMDividend set at boot.
+ * @param periodSum the sum of the tooth periods in the averaging window.
+ *
+ * @return RPM scaled by RPM_FACTOR, zero if not turning, saturated at 65535.
+ */
+unsigned short periodToRPM(unsigned long dividend, unsigned long periodSum){
+	if(periodSum == 0){
+		return 0;
+	}
+
+	unsigned long RPM = dividend / periodSum;
+	if(RPM > SHORTMAX){
+		return SHORTMAX;
+	}else{
+		return (unsigned short)RPM;
+	}
+}
+
+
+/** @brief Convert tooth periods to a noise window
+ *
+ * Predict how soon after a tooth the next real one could possibly arrive, as
+ * the configured fraction of the average tooth period.
+ *
+ * @author Fred Cooke
+ *
+ * @param periodSum the sum of the tooth periods in the averaging window.
+ *
+ * @return the minimum believable period in ticks, zero if not turning.
+ */
+unsigned long periodToNoiseWindow(unsigned long periodSum){
+	/* Shift first so the multiply can't overflow */
+	return ((periodSum / fixedConfigs1.decoderSettings.RPMAveragingTeeth) >> 8) * fixedConfigs1.decoderSettings.noiseWindowFraction;
+}
+
+
+/** @brief Convert tooth periods to a stall timeout
+ *
+ * Work out how many RTI periods may pass without a primary tooth before the
+ * engine is considered stopped, as the configured multiple of the average
+ * tooth period. One extra RTI period covers the phase of the first count.
+ *
+ * @author Fred Cooke
+ *
+ * @param periodSum the sum of the tooth periods in the averaging window.
+ *
+ * @return the timeout in RTI periods, zero if not turning.
+ */
+unsigned short periodToStallTimeout(unsigned long periodSum){
+	if(periodSum == 0){
+		return 0;
+	}
+
+	/* 0.8us ticks to 128us RTI periods */
+	unsigned long timeout = (((periodSum / fixedConfigs1.decoderSettings.RPMAveragingTeeth) / RTI_PERIOD_TICKS) * fixedConfigs1.decoderSettings.stallTimeoutTeeth) + 1;
+	if(timeout > SHORTMAX){
+		return SHORTMAX;
+	}else{
+		return (unsigned short)timeout;
+	}
+}
+
+
+/** @brief Convert cam edges to phases
+ *
+ * Turn each new cam edge capture into the angle of that cam tooth after wheel
+ * event zero, by scaling the time since the wheel event before it by the tooth
+ * period at the time. The result is lagged to keep jitter out of VVT feedback,
+ * a big jump is taken as is because it is a new tooth numbering after sync was
+ * regained, or the cam really did move that far, and lagging either is wrong.
+ *
+ * @author Fred Cooke
+ */
+void camEdgesToPhases(){
+	unsigned char tooth;
+	for(tooth = 0;tooth < fixedConfigs1.engineSettings.camTeeth;tooth++){
+		unsigned char toothBit = 1 << tooth;
+
+		ATOMIC_START(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+		unsigned char captured = camEdgesCaptured & toothBit;
+		camEdgeRecord edge = camEdges[tooth];
+		camEdgesCaptured &= ~toothBit;
+		ATOMIC_END(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+
+		if(!captured || (edge.wheelEvent >= numberOfWheelEvents)){
+			continue;
+		}
+
+		/* A cam edge captured just before a crank edge can be handled just after it, then it is behind the wheel event */
+		unsigned long ticks = edge.ticksAfterWheelEvent;
+		unsigned char behind = (ticks > (LONGMAX >> 1));
+		if(behind){
+			ticks = -ticks;
+		}
+
+		/* Only the ratio matters, so scale both down until the multiply fits */
+		unsigned long period = edge.toothPeriod;
+		while(ticks > (LONGMAX / toothPeriodAngle)){
+			ticks >>= 1;
+			period >>= 1;
+		}
+		if(period == 0){
+			continue;
+		}
+		unsigned long offset = ((ticks * toothPeriodAngle) / period) % wheelEventCycleAngle;
+		unsigned short angle;
+		if(behind){
+			angle = (wheelEventAngles[edge.wheelEvent] + wheelEventCycleAngle - offset) % wheelEventCycleAngle;
+		}else{
+			angle = (wheelEventAngles[edge.wheelEvent] + offset) % wheelEventCycleAngle;
+		}
+
+		/* Take the short way round the cycle */
+		signed long change = (signed long)angle - camToothPhases[tooth];
+		if(change > (signed long)(wheelEventCycleAngle >> 1)){
+			change -= wheelEventCycleAngle;
+		}else if(change < -(signed long)(wheelEventCycleAngle >> 1)){
+			change += wheelEventCycleAngle;
+		}
+
+		if((change > CAM_PHASE_STEP_LIMIT) || (change < -CAM_PHASE_STEP_LIMIT)){
+			camToothPhases[tooth] = angle;
+		}else{
+			signed long phase = camToothPhases[tooth] + (change / CAM_PHASE_LAG);
+			if(phase < 0){
+				phase += wheelEventCycleAngle;
+			}else if(phase >= wheelEventCycleAngle){
+				phase -= wheelEventCycleAngle;
+			}
+			camToothPhases[tooth] = phase;
+		}
+	}
+}
+
+
+/** @brief Work out the cranking angle to sync
+ *
+ * Walk back from the wheel event that sync was first gained on by the number
+ * of teeth seen before it to find the first tooth, then add up the angle in
+ * between. The time to first spark in engine angle, as nothing can be fired
+ * before sync and the first output can be scheduled from the sync tooth.
+ *
+ * @author Fred Cooke
+ *
+ * @return the angle turned from the first tooth to sync, zero if not synced since the engine was stopped.
+ */
+unsigned long firstSyncAngle(){
+	ATOMIC_START(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+	unsigned short teeth = firstSyncTeeth;
+	unsigned char syncEvent = firstSyncWheelEvent;
+	ATOMIC_END(); /*&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&*/
+
+	if((teeth == 0) || (syncEvent >= numberOfWheelEvents)){
+		return 0;
+	}
+
+	/* The first tooth is one of the counted ones, so there is one less period than teeth */
+	unsigned short periods = teeth - 1;
+	unsigned char firstEvent = ((unsigned short)syncEvent + numberOfWheelEvents - (periods % numberOfWheelEvents)) % numberOfWheelEvents;
+	unsigned long angle = (unsigned long)(periods / numberOfWheelEvents) * wheelEventCycleAngle;
+	if(wheelEventAngles[syncEvent] >= wheelEventAngles[firstEvent]){
+		angle += wheelEventAngles[syncEvent] - wheelEventAngles[firstEvent];
+	}else{
+		angle += (wheelEventCycleAngle + wheelEventAngles[syncEvent]) - wheelEventAngles[firstEvent];
+	}
+	return angle;
+}
+
+
 /** @brief Reset key state
  *
  * Reset all important variables to their non-running state.
@@ -149,9 +329,30 @@ unsigned short safeScale(unsigned short baseValue, unsigned short scaler){
  * @author Fred Cooke
  */
 void resetToNonRunningState(){
-	/* Reset RPM to zero */
-	RPM0 = 0;
-	RPM1 = 0;
+	/* Reset RPM to zero by forgetting all tooth periods */
+	unsigned char i;
+	for(i = 0;i < MAXIMUM_RPM_AVERAGING_TEETH;i++){
+		toothPeriods[i] = 0;
+	}
+	toothPeriodSum = 0;
+	toothPeriodIndex = 0;
+	latestToothPeriod = 0;
+	predictedToothPeriod = 0;
+	primaryNoiseWindow = 0;
+	toothStallTimeout = 0;
+	Clocks.toothStallClock = 0;
+	camEdgesCaptured = 0;
+	camToothIndex = 0;
+	teethBeforeSync = 0;
+	firstSyncTeeth = 0;
+
+	/* Pulses queued against the old position are no longer valid */
+	for(i = 0;i < INJECTION_CHANNELS;i++){
+		injectionQueueHeads[i] = injectionQueueTails[i];
+	}
+
+	/* As are sparks, and a coil left dwelling would never fire */
+	releaseIgnitionOutputs();
 
 	/* Ensure tacho reads lowest possible value */
 	engineCyclePeriod = ticksPerCycleAtOneRPM;
@@ -159,7 +360,7 @@ void resetToNonRunningState(){
 	/* Clear all sync flags to lost state */
 	//coreStatusA &= CLEAR_RPM_VALID;
 	coreStatusA &= CLEAR_PRIMARY_SYNC;
-	//coreStatusA &= CLEAR_SECONDARY_SYNC;
+	coreStatusA &= CLEAR_SECONDARY_SYNC;
 
 	// TODO more stuff needs resetting here, but only critical things.
 }